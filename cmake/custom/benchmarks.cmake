@@ -0,0 +1,20 @@
+if(ENABLE_BENCHMARKS)
+  find_package(benchmark 1.6 CONFIG QUIET)
+
+  if(benchmark_FOUND)
+    message(STATUS "Found Google Benchmark: ${benchmark_DIR} (found version ${benchmark_VERSION})")
+  else()
+    message(STATUS "Suitable Google Benchmark could not be located. Fetching and building!")
+    include(FetchContent)
+    FetchContent_Declare(benchmark
+      QUIET
+      URL
+        https://github.com/google/benchmark/archive/v1.8.3.tar.gz
+      )
+    set(BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "")
+    set(BENCHMARK_ENABLE_INSTALL OFF CACHE BOOL "")
+    FetchContent_MakeAvailable(benchmark)
+  endif()
+
+  add_subdirectory(src/vampyr/benchmarks)
+endif()
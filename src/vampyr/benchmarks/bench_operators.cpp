@@ -0,0 +1,52 @@
+/*
+ * Benchmarks of operator application. Operators are constructed once per
+ * benchmark, only their application is timed. Arguments are
+ * (order, -log10(prec)).
+ */
+
+#include <MRCPP/operators/ABGVOperator.h>
+#include <MRCPP/operators/HelmholtzOperator.h>
+#include <MRCPP/operators/PoissonOperator.h>
+#include <MRCPP/treebuilders/apply.h>
+
+#include "bench_utils.h"
+
+using namespace mrcpp;
+using namespace vampyr::bench;
+
+template <typename Oper> static void BM_Convolution(benchmark::State &state, Oper oper) {
+    auto mra = make_mra<3>(state.range(0));
+    auto prec = std::pow(10.0, -state.range(1));
+    auto inp = project_gauss<3>(mra, prec);
+    auto op = oper(mra, prec);
+    for (auto _ : state) {
+        FunctionTree<3, double> out(mra);
+        apply<3, double>(prec, out, *op, *inp);
+        set_counters<3>(state, out);
+    }
+}
+
+static void BM_Poisson(benchmark::State &state) {
+    BM_Convolution(state, [](const MultiResolutionAnalysis<3> &mra, double prec) { return std::make_unique<PoissonOperator>(mra, prec); });
+}
+
+static void BM_Helmholtz(benchmark::State &state) {
+    BM_Convolution(state, [](const MultiResolutionAnalysis<3> &mra, double prec) { return std::make_unique<HelmholtzOperator>(mra, 1.0, prec); });
+}
+
+template <int D> static void BM_Derivative(benchmark::State &state) {
+    auto mra = make_mra<D>(state.range(0));
+    auto prec = std::pow(10.0, -state.range(1));
+    auto inp = project_gauss<D>(mra, prec);
+    ABGVOperator<D> oper(mra, 0.5, 0.5);
+    for (auto _ : state) {
+        FunctionTree<D, double> out(mra);
+        apply<D, double>(out, oper, *inp, 0);
+        set_counters<D>(state, out);
+    }
+}
+
+BENCHMARK(BM_Poisson)->ArgsProduct({orders_3d, precs_3d})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Helmholtz)->ArgsProduct({orders_3d, precs_3d})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Derivative, 1)->ArgsProduct({orders_1d, precs_1d})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Derivative, 3)->ArgsProduct({orders_3d, precs_3d})->Unit(benchmark::kMillisecond);
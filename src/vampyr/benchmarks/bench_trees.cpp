@@ -0,0 +1,104 @@
+/*
+ * Benchmarks of projection, grid building, arithmetics and I/O, using the
+ * same code paths as the bindings. Arguments are (order, -log10(prec)),
+ * except for grid building, which has no precision and is driven by the
+ * exponent of the Gaussian, (order, log10(beta)).
+ */
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "bench_utils.h"
+#include "treebuilders/PyProjectors.h"
+#include "trees/trees.h"
+
+using namespace mrcpp;
+using namespace vampyr::bench;
+
+template <int D> static void BM_Project(benchmark::State &state) {
+    auto mra = make_mra<D>(state.range(0));
+    auto prec = std::pow(10.0, -state.range(1));
+    auto gauss = make_gauss<D>();
+    for (auto _ : state) {
+        FunctionTree<D, double> tree(mra);
+        mrcpp::project<D, double>(prec, tree, gauss);
+        set_counters<D>(state, tree);
+    }
+}
+
+template <int D> static void BM_ProjectBatch(benchmark::State &state) {
+    auto mra = make_mra<D>(state.range(0));
+    auto prec = std::pow(10.0, -state.range(1));
+    auto gauss = make_gauss<D>();
+    BatchFunction func = [&gauss](const std::vector<double> &pts, std::vector<double> &vals) {
+        for (size_t i = 0; i < vals.size(); i++) {
+            Coord<D> r;
+            for (int d = 0; d < D; d++) r[d] = pts[i * D + d];
+            vals[i] = gauss.evalf(r);
+        }
+    };
+    for (auto _ : state) {
+        FunctionTree<D, double> tree(mra);
+        batch_project<D>(prec, tree, func);
+        set_counters<D>(state, tree);
+    }
+}
+
+template <int D> static void BM_BuildGrid(benchmark::State &state) {
+    auto mra = make_mra<D>(state.range(0));
+    auto gauss = make_gauss<D>(std::pow(10.0, state.range(1)));
+    for (auto _ : state) {
+        FunctionTree<D, double> tree(mra);
+        build_grid(tree, gauss);
+        set_grid_counters<D>(state, tree);
+    }
+}
+
+template <int D> static void BM_Add(benchmark::State &state) {
+    auto mra = make_mra<D>(state.range(0));
+    auto prec = std::pow(10.0, -state.range(1));
+    auto a = project_gauss<D>(mra, prec, 10.0);
+    auto b = project_gauss<D>(mra, prec, 20.0);
+    for (auto _ : state) {
+        auto out = vampyr::impl__add__<D>(a.get(), b.get());
+        set_counters<D>(state, *out);
+    }
+}
+
+template <int D> static void BM_Multiply(benchmark::State &state) {
+    auto mra = make_mra<D>(state.range(0));
+    auto prec = std::pow(10.0, -state.range(1));
+    auto a = project_gauss<D>(mra, prec, 10.0);
+    auto b = project_gauss<D>(mra, prec, 20.0);
+    for (auto _ : state) {
+        auto out = vampyr::impl__mul__<D>(a.get(), b.get());
+        set_counters<D>(state, *out);
+    }
+}
+
+template <int D> static void BM_SaveLoad(benchmark::State &state) {
+    auto mra = make_mra<D>(state.range(0));
+    auto prec = std::pow(10.0, -state.range(1));
+    auto tree = project_gauss<D>(mra, prec);
+    auto name = (std::filesystem::temp_directory_path() / ("vampyr_bench_" + std::to_string(D) + "d")).string();
+    for (auto _ : state) {
+        tree->saveTree(name);
+        FunctionTree<D, double> loaded(mra);
+        loaded.loadTree(name);
+        set_counters<D>(state, loaded);
+    }
+    std::filesystem::remove(name + ".tree");
+}
+
+#define VAMPYR_BENCHMARK(func)                                                                                          \
+    BENCHMARK_TEMPLATE(func, 1)->ArgsProduct({orders_1d, precs_1d})->Unit(benchmark::kMillisecond);                    \
+    BENCHMARK_TEMPLATE(func, 3)->ArgsProduct({orders_3d, precs_3d})->Unit(benchmark::kMillisecond)
+
+VAMPYR_BENCHMARK(BM_Project);
+VAMPYR_BENCHMARK(BM_ProjectBatch);
+BENCHMARK_TEMPLATE(BM_BuildGrid, 1)->ArgsProduct({orders_1d, exps_1d})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_BuildGrid, 3)->ArgsProduct({orders_3d, exps_3d})->Unit(benchmark::kMillisecond);
+VAMPYR_BENCHMARK(BM_Add);
+VAMPYR_BENCHMARK(BM_Multiply);
+VAMPYR_BENCHMARK(BM_SaveLoad);
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <MRCPP/constants.h>
+#include <MRCPP/functions/GaussFunc.h>
+#include <MRCPP/treebuilders/grid.h>
+#include <MRCPP/treebuilders/project.h>
+#include <MRCPP/trees/FunctionTree.h>
+#include <MRCPP/trees/MultiResolutionAnalysis.h>
+
+namespace vampyr {
+namespace bench {
+
+// Orders and precisions (as -log10) for the benchmark arguments
+inline const std::vector<std::int64_t> orders_1d = {5, 7, 9};
+inline const std::vector<std::int64_t> orders_3d = {5, 7};
+inline const std::vector<std::int64_t> precs_1d = {3, 5, 7};
+inline const std::vector<std::int64_t> precs_3d = {3, 5};
+
+// Gaussian exponents (as log10) for the grid building arguments
+inline const std::vector<std::int64_t> exps_1d = {1, 3, 5};
+inline const std::vector<std::int64_t> exps_3d = {1, 3};
+
+/** @returns An MRA on [-4, 4]^D of the given order */
+template <int D> mrcpp::MultiResolutionAnalysis<D> make_mra(int order) {
+    std::array<int, D> corner, nboxes;
+    std::array<double, D> scaling;
+    corner.fill(-1);
+    nboxes.fill(2);
+    scaling.fill(4.0);
+    mrcpp::BoundingBox<D> world(0, corner, nboxes, scaling, false);
+    return mrcpp::MultiResolutionAnalysis<D>(world, order, 30);
+}
+
+/** @returns A normalized Gaussian off the origin */
+template <int D> mrcpp::GaussFunc<D> make_gauss(double beta = 10.0) {
+    mrcpp::Coord<D> pos;
+    pos.fill(0.1);
+    double alpha = std::pow(beta / mrcpp::pi, D / 2.0);
+    return mrcpp::GaussFunc<D>(beta, alpha, pos, std::array<int, D>{});
+}
+
+/** @returns The Gaussian projected at precision prec */
+template <int D> std::unique_ptr<mrcpp::FunctionTree<D, double>> project_gauss(const mrcpp::MultiResolutionAnalysis<D> &mra, double prec, double beta = 10.0) {
+    auto gauss = make_gauss<D>(beta);
+    auto tree = std::make_unique<mrcpp::FunctionTree<D, double>>(mra);
+    mrcpp::build_grid(*tree, gauss);
+    mrcpp::project<D, double>(prec, *tree, gauss);
+    return tree;
+}
+
+/** Reports the node count of the output tree, for arguments (order, -log10(prec)) */
+template <int D> void set_counters(benchmark::State &state, const mrcpp::FunctionTree<D, double> &tree) {
+    state.counters["nodes"] = tree.getNNodes();
+    state.counters["order"] = state.range(0);
+    state.counters["prec"] = std::pow(10.0, -state.range(1));
+}
+
+/** Reports the node count of the output tree, for arguments (order, log10(beta)) */
+template <int D> void set_grid_counters(benchmark::State &state, const mrcpp::FunctionTree<D, double> &tree) {
+    state.counters["nodes"] = tree.getNNodes();
+    state.counters["order"] = state.range(0);
+    state.counters["beta"] = std::pow(10.0, state.range(1));
+}
+
+} // namespace bench
+} // namespace vampyr
@@ -0,0 +1,313 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <MRCPP/Parallel>
+
+#include "trees/PyTreeMemory.h"
+
+namespace vampyr {
+
+// One profiled call of a bound operation
+struct ProfileRecord {
+    std::string name;
+    double start;          // seconds since the profiler epoch
+    double wall;           // seconds
+    int threads;           // MRCPP threads available to the call
+    std::size_t thread_id; // calling (Python) thread
+    long inp_nodes;        // nodes of the input trees at entry
+    long out_nodes;        // nodes of the output trees at exit
+    long gen_nodes;        // GenNodes still held by the trees at exit
+    long bytes;            // node memory allocated for the outputs
+};
+
+// Records collected between the start and stop of one profile() context
+class ProfileSession final {
+public:
+    void add(const ProfileRecord &rec) {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        this->records.push_back(rec);
+    }
+    std::vector<ProfileRecord> getRecords() const {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        return this->records;
+    }
+    void clear() {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        this->records.clear();
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::vector<ProfileRecord> records;
+};
+
+/*
+ * Process-wide registry of active profile sessions. Bound operations check
+ * enabled() on entry, which is a single relaxed atomic load, so profiling
+ * costs nothing while no session is active. Records are delivered to all
+ * sessions active when the operation finishes, so sessions may be nested.
+ */
+class Profiler final {
+public:
+    static Profiler &get() {
+        static auto *profiler = new Profiler();
+        return *profiler;
+    }
+
+    bool enabled() const { return this->nActive.load(std::memory_order_relaxed) > 0; }
+
+    double now() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - this->epoch).count(); }
+
+    void start(std::shared_ptr<ProfileSession> session) {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        this->sessions.push_back(std::move(session));
+        this->nActive.store(this->sessions.size());
+    }
+
+    void stop(const std::shared_ptr<ProfileSession> &session) {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        auto it = std::find(this->sessions.begin(), this->sessions.end(), session);
+        if (it != this->sessions.end()) this->sessions.erase(it);
+        this->nActive.store(this->sessions.size());
+    }
+
+    void record(const ProfileRecord &rec) {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        for (auto &session : this->sessions) session->add(rec);
+    }
+
+private:
+    Profiler() = default;
+
+    std::mutex mutex;
+    std::atomic<int> nActive{0};
+    std::vector<std::shared_ptr<ProfileSession>> sessions;
+    std::chrono::steady_clock::time_point epoch{std::chrono::steady_clock::now()};
+};
+
+/*
+ * Process-wide tracker of the memory held by function trees.
+ *
+ * The total is the running byte count of the trees owned by Python, see
+ * PyTreeCounter, plus the current size of the trees the operation works on.
+ * While tracking is enabled the total is sampled at the end of every bound
+ * operation, and by the heavy operations (apply, map, expressions, rotate and
+ * the list dot) while their GenNodes and temporary trees are still allocated,
+ * see ProfileScope::sample(). The largest values are kept, overall and per
+ * operation. Temporaries allocated and freed inside other MRCPP routines are
+ * not seen.
+ */
+class MemoryTracker final {
+public:
+    static MemoryTracker &get() {
+        static auto *tracker = new MemoryTracker();
+        return *tracker;
+    }
+
+    bool enabled() const { return this->tracking.load(std::memory_order_relaxed); }
+    void setEnabled(bool enable) { this->tracking.store(enable); }
+
+    void update(const std::string &operation, long current) {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        this->peak = std::max(this->peak, current);
+        if (not operation.empty()) {
+            auto &hwm = this->operations[operation];
+            hwm = std::max(hwm, current);
+        }
+    }
+
+    long getPeak() const {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        return this->peak;
+    }
+
+    std::map<std::string, long> getOperations() const {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        return this->operations;
+    }
+
+    void reset() {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        this->peak = 0;
+        this->operations.clear();
+    }
+
+private:
+    MemoryTracker() = default;
+
+    mutable std::mutex mutex;
+    std::atomic<bool> tracking{false};
+    long peak{0};
+    std::map<std::string, long> operations;
+};
+
+// Bytes of node and coefficient chunks allocated by a tree
+template <typename Tree> long tree_bytes(Tree &tree) {
+    return mrcpp::tree_memory(tree).allocated();
+}
+
+/*
+ * Records one call of a bound operation in the active profile sessions, and
+ * samples the memory tracker at its end.
+ *
+ * The innermost scope of a thread is available through current(), so that
+ * the building blocks of an operation can sample the memory tracker while
+ * their temporaries are allocated, see sample_memory().
+ *
+ * Constructed at the start of the operation with its input trees, taking
+ * the same arguments as TreeLock. Output trees are registered with output(),
+ * either before or after they are built, and are measured when the scope
+ * ends, which also refreshes their bytes in the PyTreeCounter. Trees that are
+ * both input and output (in-place operations) are only charged for their
+ * growth. Apart from the counter, does nothing unless profiling or memory
+ * tracking is enabled.
+ */
+class ProfileScope final {
+public:
+    template <typename... Objs> explicit ProfileScope(const char *name, const Objs &...objs)
+            : nExceptions(std::uncaught_exceptions())
+            , previous(current()) {
+        current_scope() = this;
+        auto &profiler = Profiler::get();
+        this->profiling = profiler.enabled();
+        this->tracking = MemoryTracker::get().enabled();
+        this->active = this->profiling or this->tracking;
+        if (not this->active) return;
+        this->rec.name = name;
+        this->rec.threads = mrcpp_get_num_threads();
+        this->rec.thread_id = std::hash<std::thread::id>{}(std::this_thread::get_id());
+        this->rec.inp_nodes = 0;
+        (collect(this->inputs, objs), ...);
+        for (auto &t : this->inputs) {
+            this->rec.inp_nodes += std::get<1>(t)();
+            this->baseline[std::get<0>(t)] = std::get<2>(t)();
+        }
+        this->rec.start = profiler.now();
+    }
+
+    template <typename... Objs> void output(const Objs &...objs) { (collect(this->outputs, objs), ...); }
+
+    /** @returns The innermost scope of the calling thread, or nullptr */
+    static ProfileScope *current() { return current_scope(); }
+
+    /*
+     * Samples the memory tracker with the given trees at their current size,
+     * e.g. before the GenNodes of the inputs are deleted. Trees not counted by
+     * the PyTreeCounter, like temporaries, are added in full. Only reads the
+     * given trees, so may be called by the thread building them.
+     */
+    template <typename... Objs> void sample(const Objs &...objs) const {
+        if (not this->tracking) return;
+        std::vector<Probe> probes;
+        (collect(probes, objs), ...);
+        sampleProbes(probes);
+    }
+
+    ~ProfileScope() {
+        current_scope() = this->previous;
+        // Outputs may already be destroyed when the operation throws
+        if (std::uncaught_exceptions() > this->nExceptions) return;
+        // The outputs are still locked by the operation
+        std::vector<long> outBytes;
+        for (auto &t : this->outputs) {
+            outBytes.push_back(std::get<2>(t)());
+            mrcpp::PyTreeCounter::get().update(std::get<0>(t), outBytes.back());
+        }
+        if (not this->active) return;
+        auto &profiler = Profiler::get();
+        this->rec.wall = profiler.now() - this->rec.start;
+        this->rec.out_nodes = 0;
+        this->rec.gen_nodes = 0;
+        this->rec.bytes = 0;
+        for (size_t i = 0; i < this->outputs.size(); i++) {
+            const auto &t = this->outputs[i];
+            auto it = this->baseline.find(std::get<0>(t));
+            this->rec.out_nodes += std::get<1>(t)();
+            this->rec.bytes += outBytes[i] - ((it != this->baseline.end()) ? it->second : 0);
+        }
+        for (auto &t : this->inputs) this->rec.gen_nodes += std::get<3>(t)();
+        for (auto &t : this->outputs) this->rec.gen_nodes += std::get<3>(t)();
+        if (this->tracking) {
+            // Inputs may still hold GenNode chunks
+            auto probes = this->inputs;
+            probes.insert(probes.end(), this->outputs.begin(), this->outputs.end());
+            sampleProbes(probes);
+        }
+        if (this->profiling) profiler.record(this->rec);
+    }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+    // Tree address, and deferred node count, bytes and GenNode count
+    using Probe = std::tuple<const void *, std::function<long()>, std::function<long()>, std::function<long()>>;
+
+    int nExceptions;
+    ProfileScope *previous;
+    bool active{false};
+    bool profiling{false};
+    bool tracking{false};
+    ProfileRecord rec;
+    std::vector<Probe> inputs;
+    std::vector<Probe> outputs;
+    std::map<const void *, long> baseline;
+
+    static ProfileScope *&current_scope() {
+        thread_local ProfileScope *scope = nullptr;
+        return scope;
+    }
+
+    // Counted total, corrected by the current size of each distinct tree
+    void sampleProbes(const std::vector<Probe> &probes) const {
+        auto &counter = mrcpp::PyTreeCounter::get();
+        long total = counter.getBytes();
+        std::vector<const void *> seen;
+        for (auto &t : probes) {
+            if (std::find(seen.begin(), seen.end(), std::get<0>(t)) != seen.end()) continue;
+            seen.push_back(std::get<0>(t));
+            total += std::get<2>(t)() - counter.getBytes(std::get<0>(t));
+        }
+        MemoryTracker::get().update(this->rec.name, total);
+    }
+
+    template <typename Tree> static void collect(std::vector<Probe> &probes, Tree *tree) {
+        if (tree == nullptr) return;
+        probes.emplace_back(
+            static_cast<const void *>(tree),
+            [tree]() -> long { return tree->getNNodes(); },
+            [tree]() -> long { return tree_bytes(*tree); },
+            [tree]() -> long { return tree->getNGenNodes(); });
+    }
+
+    template <typename Tree, typename Del> static void collect(std::vector<Probe> &probes, const std::unique_ptr<Tree, Del> &tree) {
+        collect(probes, tree.get());
+    }
+
+    template <typename T> static void collect(std::vector<Probe> &probes, const std::vector<T> &trees) {
+        for (const auto &tree : trees) collect(probes, tree);
+    }
+
+    template <typename C, typename Tree> static void collect(std::vector<Probe> &probes, const std::tuple<C, Tree *> &t) { collect(probes, std::get<1>(t)); }
+};
+
+/** Samples the memory tracker in the innermost profile scope of the calling thread, if any */
+template <typename... Objs> void sample_memory(const Objs &...objs) {
+    if (auto *scope = ProfileScope::current()) scope->sample(objs...);
+}
+
+} // namespace vampyr
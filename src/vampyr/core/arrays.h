@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+
+namespace vampyr {
+
+/*
+ * Read-only NumPy array of the given shape over the values of vec, without
+ * copying. The array does not own the values, so it must not be kept beyond
+ * the call it is passed to, as for the arguments of batch callbacks.
+ */
+inline pybind11::array_t<double> readonly_array(const std::vector<double> &vec, std::vector<pybind11::ssize_t> shape) {
+    namespace py = pybind11;
+    using namespace pybind11::literals;
+    // With a base object NumPy wraps the data instead of copying it
+    py::capsule base(vec.data(), [](void *) {});
+    py::array_t<double> arr(std::move(shape), vec.data(), base);
+    arr.attr("setflags")("write"_a = false);
+    return arr;
+}
+
+} // namespace vampyr
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <MRCPP/trees/FunctionTree.h>
+
+#include "Profiler.h"
+#include "trees/PyTreeMemory.h"
+#include "trees/PyTreePool.h"
+
+namespace vampyr {
+
+// Bytes held by the trees kept in the pools
+inline long pooled_tree_bytes() {
+    return mrcpp::PyTreePool<1>::get().size().second + mrcpp::PyTreePool<2>::get().size().second +
+           mrcpp::PyTreePool<3>::get().size().second;
+}
+
+void memory(pybind11::module &m) {
+    namespace py = pybind11;
+    using namespace pybind11::literals;
+
+    m.def(
+        "memory_usage",
+        []() {
+            auto &counter = mrcpp::PyTreeCounter::get();
+            auto current = counter.getBytes();
+            auto &tracker = MemoryTracker::get();
+            tracker.update("", current);
+            return py::dict("current"_a = current,
+                            "peak"_a = tracker.getPeak(),
+                            "trees"_a = counter.getNTrees(),
+                            "pooled"_a = pooled_tree_bytes(),
+                            "operations"_a = tracker.getOperations());
+        },
+        R"mydelimiter(
+        Memory held by all function trees alive in Python, in bytes.
+
+        Returns a dict with the current total, the peak total, the number of
+        trees, the memory kept by the tree pool (see set_tree_pool()), which
+        is not part of the totals, and the high-water mark per operation, i.e.
+        the largest total seen during each bound operation. The total is kept
+        up to date by the bound operations, and the memory of a tree is
+        refreshed by the operations that output it and by its memory() method.
+
+        Peaks are sampled whenever this function is called and, while
+        track_memory() is enabled, at the end of every operation. Operator
+        application, maps, expressions, rotate() and the list dot() are also
+        sampled while their GenNodes and temporary trees are allocated, which
+        is when they use the most memory. Temporaries allocated internally by
+        other MRCPP routines, e.g. in multiplications, are not seen.
+        )mydelimiter");
+
+    m.def(
+        "track_memory",
+        [](bool enable) { MemoryTracker::get().setEnabled(enable); },
+        "enable"_a = true,
+        R"mydelimiter(
+        Enable or disable sampling of the tree memory in the bound operations.
+
+        Sampling reads the running total of the tree memory and the size of
+        the trees of the operation, and takes a lock shared by all threads,
+        so it is off by default.
+        )mydelimiter");
+
+    m.def(
+        "reset_memory_peak",
+        []() { MemoryTracker::get().reset(); },
+        "Reset the peak and the per-operation high-water marks of memory_usage().");
+
+    m.def(
+        "set_tree_pool",
+        [](int capacity) {
+            mrcpp::PyTreePool<1>::get().setCapacity(capacity);
+            mrcpp::PyTreePool<2>::get().setCapacity(capacity);
+            mrcpp::PyTreePool<3>::get().setCapacity(capacity);
+        },
+        "capacity"_a,
+        py::call_guard<py::gil_scoped_release>(),
+        R"mydelimiter(
+        Keep up to capacity released trees per MRA for reuse.
+
+        Trees dropped by Python, and temporaries of the bound operations, are
+        then cleared and handed out again as outputs of later operations.
+        Their nodes and coefficients stay allocated, which saves the cost of
+        allocating new memory in loops that create many temporary trees, at
+        the price of keeping that memory until trim_tree_pool() is called.
+        A capacity of zero, the default, disables the pool.
+        )mydelimiter");
+
+    m.def(
+        "trim_tree_pool",
+        []() {
+            mrcpp::PyTreePool<1>::get().trim();
+            mrcpp::PyTreePool<2>::get().trim();
+            mrcpp::PyTreePool<3>::get().trim();
+        },
+        py::call_guard<py::gil_scoped_release>(),
+        "Free all trees kept by the tree pool, the capacity is unchanged.");
+}
+
+} // namespace vampyr
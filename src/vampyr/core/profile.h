@@ -0,0 +1,145 @@
+#pragma once
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <pybind11/stl/filesystem.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Profiler.h"
+
+namespace vampyr {
+
+// Chrome trace event format, viewable in chrome://tracing or Perfetto
+inline std::string chrome_trace(const std::vector<ProfileRecord> &records) {
+    std::ostringstream os;
+    os << std::setprecision(15) << "{\"traceEvents\": [";
+    for (size_t i = 0; i < records.size(); i++) {
+        const auto &r = records[i];
+        if (i > 0) os << ",";
+        os << "\n  {\"name\": \"" << r.name << "\", \"cat\": \"vampyr\", \"ph\": \"X\", \"pid\": 0";
+        os << ", \"tid\": " << r.thread_id << ", \"ts\": " << 1.0e6 * r.start << ", \"dur\": " << 1.0e6 * r.wall;
+        os << ", \"args\": {\"threads\": " << r.threads << ", \"inp_nodes\": " << r.inp_nodes << ", \"out_nodes\": " << r.out_nodes;
+        os << ", \"gen_nodes\": " << r.gen_nodes << ", \"bytes\": " << r.bytes << "}}";
+    }
+    os << "\n], \"displayTimeUnit\": \"ms\"}\n";
+    return os.str();
+}
+
+// Per operation totals, sorted by total wall time
+inline std::string profile_table(const std::vector<ProfileRecord> &records) {
+    struct Summary {
+        long calls{0}, out_nodes{0}, bytes{0};
+        double total{0.0}, max{0.0};
+    };
+    std::map<std::string, Summary> summary;
+    for (const auto &r : records) {
+        auto &s = summary[r.name];
+        s.calls++;
+        s.total += r.wall;
+        s.max = std::max(s.max, r.wall);
+        s.out_nodes += r.out_nodes;
+        s.bytes += r.bytes;
+    }
+    std::vector<std::pair<std::string, Summary>> rows(summary.begin(), summary.end());
+    std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) { return a.second.total > b.second.total; });
+
+    std::ostringstream os;
+    os << std::left << std::setw(28) << "operation" << std::right << std::setw(8) << "calls" << std::setw(12) << "total (s)"
+       << std::setw(12) << "mean (s)" << std::setw(12) << "max (s)" << std::setw(14) << "out nodes" << std::setw(14) << "bytes" << "\n";
+    os << std::fixed << std::setprecision(4);
+    for (const auto &[name, s] : rows) {
+        os << std::left << std::setw(28) << name << std::right << std::setw(8) << s.calls << std::setw(12) << s.total << std::setw(12)
+           << s.total / s.calls << std::setw(12) << s.max << std::setw(14) << s.out_nodes << std::setw(14) << s.bytes << "\n";
+    }
+    return os.str();
+}
+
+void profile(pybind11::module &m) {
+    namespace py = pybind11;
+    using namespace pybind11::literals;
+
+    py::class_<ProfileSession, std::shared_ptr<ProfileSession>>(m,
+                                                                "Profile",
+                                                                // clang-format off
+    R"mydelimiter(
+        Timings of bound operations, recorded within a profile() context.
+
+        Every compute-heavy operation (arithmetics, projections, operator
+        applications, grid building, ...) records its wall time, the number
+        of MRCPP threads, the nodes of its input and output trees, the
+        GenNodes left on the trees and the node memory allocated for its
+        outputs.
+    )mydelimiter")
+        // clang-format on
+        .def("__enter__",
+             [](std::shared_ptr<ProfileSession> self) {
+                 Profiler::get().start(self);
+                 return self;
+             })
+        .def("__exit__", [](std::shared_ptr<ProfileSession> self, py::args) { Profiler::get().stop(self); })
+        .def(
+            "records",
+            [](const ProfileSession &self) {
+                py::list out;
+                for (const auto &r : self.getRecords()) {
+                    out.append(py::dict("name"_a = r.name,
+                                        "start"_a = r.start,
+                                        "wall"_a = r.wall,
+                                        "threads"_a = r.threads,
+                                        "thread_id"_a = r.thread_id,
+                                        "inp_nodes"_a = r.inp_nodes,
+                                        "out_nodes"_a = r.out_nodes,
+                                        "gen_nodes"_a = r.gen_nodes,
+                                        "bytes"_a = r.bytes));
+                }
+                return out;
+            },
+            "List of records, one dict per call, e.g. for pandas.DataFrame.")
+        .def(
+            "table",
+            [](const ProfileSession &self) { return profile_table(self.getRecords()); },
+            "Summary per operation, sorted by total wall time.")
+        .def(
+            "chrome_trace",
+            [](const ProfileSession &self) { return chrome_trace(self.getRecords()); },
+            "Records as Chrome trace JSON, viewable in chrome://tracing or Perfetto.")
+        .def(
+            "save_chrome_trace",
+            [](const ProfileSession &self, const std::filesystem::path &filename) {
+                std::ofstream out(filename);
+                out << chrome_trace(self.getRecords());
+                return std::filesystem::absolute(filename);
+            },
+            "filename"_a)
+        .def("clear", &ProfileSession::clear)
+        .def("__len__", [](const ProfileSession &self) { return self.getRecords().size(); })
+        .def("__str__", [](const ProfileSession &self) { return profile_table(self.getRecords()); });
+
+    m.def(
+        "profile",
+        []() { return std::make_shared<ProfileSession>(); },
+        R"mydelimiter(
+        Profile the bound operations called within a context.
+
+        Usage::
+
+            with vampyr.profile() as p:
+                ...
+            print(p.table())
+            p.save_chrome_trace("trace.json")
+
+        Profiling is off outside of such contexts and has no cost then.
+        Calls made from any Python thread are recorded.
+        )mydelimiter");
+}
+
+} // namespace vampyr
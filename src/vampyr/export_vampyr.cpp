@@ -14,14 +14,19 @@
 
 #include "core/bases.h"
 #include "core/filter.h"
+#include "core/memory.h"
+#include "core/profile.h"
 #include "functions/functions.h"
+#include "operators/cache.h"
 #include "operators/convolutions.h"
 #include "operators/derivatives.h"
 #include "treebuilders/applys.h"
 #include "treebuilders/arithmetics.h"
+#include "treebuilders/expressions.h"
 #include "treebuilders/grids.h"
 #include "treebuilders/maps.h"
 #include "treebuilders/project.h"
+#include "trees/treefile.h"
 #include "trees/trees.h"
 #include "trees/world.h"
 
@@ -58,10 +63,12 @@ template <int D> void bind_vampyr(py::module &mod) noexcept {
 
     functions<D>(sub_mod);
     trees<D>(sub_mod);
+    treefile<D>(sub_mod);
     world<D>(sub_mod);
     grids<D>(sub_mod);
     applys<D>(sub_mod);
     arithmetics<D>(sub_mod);
+    expressions<D>(sub_mod);
     project<D>(sub_mod);
     map<D>(sub_mod);
     derivatives<D>(sub_mod);
@@ -89,6 +96,10 @@ PYBIND11_MODULE(_vampyr, m) {
 
     // Dimension-independent bindings go in the main module
     constants(m);
+    operator_cache(m);
+    profile(m);
+    memory(m);
+    map_kernels(m);
 
     // Dimension-dependent bindings go into submodules
     bind_vampyr<1>(m);
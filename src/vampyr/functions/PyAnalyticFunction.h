@@ -0,0 +1,480 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <MRCPP/Parallel>
+#include <MRCPP/constants.h>
+#include <MRCPP/functions/RepresentableFunction.h>
+
+#include "PyBatchEvaluator.h"
+
+namespace mrcpp {
+
+/*
+ * Analytic function given by an expression string, e.g. "exp(-a*r2)*x".
+ *
+ * The expression is parsed once into a postfix bytecode, with the bound
+ * parameters and constant subexpressions folded in. Batches of points are
+ * evaluated one instruction at a time over blocks of points, with simple
+ * loops that the compiler can vectorize, and blocks are processed in
+ * parallel. Evaluation never calls back into Python, so projections of
+ * these functions run on all MRCPP threads.
+ *
+ * Variables: x, y, z (the first D of them), r = |r| and r2 = |r|^2
+ * Constants: pi and the bound parameters
+ * Operators: + - * / ^ ** and unary -
+ * Functions: exp log sqrt abs sin cos tan sinh cosh tanh atan erf erfc,
+ *            pow(a, b) min(a, b) max(a, b)
+ */
+template <int D> class PyAnalyticFunction final : public RepresentableFunction<D, double>, public PyBatchEvaluator<D> {
+public:
+    PyAnalyticFunction(const std::string &expr, const std::map<std::string, double> &params = {})
+            : expression(expr)
+            , parameters(params) {
+        for (const auto &p : params) {
+            const auto &name = p.first;
+            if (variable(name) >= 0 or unary(name) != Op::Const or binary(name) != Op::Const or name == "r" or name == "r2" or name == "pi") {
+                throw std::invalid_argument("Parameter name is reserved: " + name);
+            }
+        }
+        Parser parser{expr, 0, *this};
+        parser.parseExpression();
+        parser.skipSpace();
+        if (parser.pos != expr.size()) parser.fail("Unexpected character");
+        if (this->maxDepth > max_stack) throw std::invalid_argument("Expression is nested too deeply");
+    }
+
+    const std::string &getExpression() const { return this->expression; }
+    const std::map<std::string, double> &getParameters() const { return this->parameters; }
+
+    double evalf(const Coord<D> &r) const override {
+        double stack[max_stack];
+        int top = -1;
+        for (const auto &ins : this->code) {
+            double r2 = 0.0;
+            switch (ins.op) {
+                case Op::Const:
+                    stack[++top] = ins.value;
+                    break;
+                case Op::Var:
+                    stack[++top] = r[ins.arg];
+                    break;
+                case Op::R:
+                case Op::R2:
+                    for (int d = 0; d < D; d++) r2 += r[d] * r[d];
+                    stack[++top] = (ins.op == Op::R) ? std::sqrt(r2) : r2;
+                    break;
+                default:
+                    if (isBinary(ins.op)) {
+                        top--;
+                        stack[top] = apply(ins.op, stack[top], stack[top + 1]);
+                    } else {
+                        stack[top] = apply(ins.op, stack[top], 0.0);
+                    }
+            }
+        }
+        return stack[0];
+    }
+
+    // Points are evaluated in parallel blocks
+    void evalf_batch(const std::vector<double> &pts, std::vector<double> &vals) const override {
+        const int nPts = vals.size();
+        const int nBlocks = (nPts + block_size - 1) / block_size;
+#pragma omp parallel num_threads(mrcpp_get_num_threads())
+        {
+            std::vector<double> stack(static_cast<size_t>(this->maxDepth) * block_size);
+#pragma omp for schedule(static)
+            for (int b = 0; b < nBlocks; b++) {
+                int start = b * block_size;
+                int n = std::min(block_size, nPts - start);
+                evalBlock(pts.data() + static_cast<size_t>(start) * D, n, stack.data());
+                std::copy(stack.begin(), stack.begin() + n, vals.begin() + start);
+            }
+        }
+    }
+
+private:
+    enum class Op { Const, Var, R, R2, Neg, Square, Exp, Log, Sqrt, Abs, Sin, Cos, Tan, Sinh, Cosh, Tanh, Atan, Erf, Erfc, Add, Sub, Mul, Div, Pow, Min, Max };
+
+    struct Instruction {
+        Op op;
+        int arg;
+        double value;
+    };
+
+    static constexpr int max_stack = 64;
+    static constexpr int max_nesting = 256;
+    static constexpr int block_size = 256;
+
+    std::string expression;
+    std::map<std::string, double> parameters;
+    std::vector<Instruction> code;
+    int depth{0};
+    int maxDepth{0};
+
+    static bool isBinary(Op op) { return op >= Op::Add; }
+
+    static double apply(Op op, double a, double b) {
+        switch (op) {
+            case Op::Neg:
+                return -a;
+            case Op::Square:
+                return a * a;
+            case Op::Exp:
+                return std::exp(a);
+            case Op::Log:
+                return std::log(a);
+            case Op::Sqrt:
+                return std::sqrt(a);
+            case Op::Abs:
+                return std::abs(a);
+            case Op::Sin:
+                return std::sin(a);
+            case Op::Cos:
+                return std::cos(a);
+            case Op::Tan:
+                return std::tan(a);
+            case Op::Sinh:
+                return std::sinh(a);
+            case Op::Cosh:
+                return std::cosh(a);
+            case Op::Tanh:
+                return std::tanh(a);
+            case Op::Atan:
+                return std::atan(a);
+            case Op::Erf:
+                return std::erf(a);
+            case Op::Erfc:
+                return std::erfc(a);
+            case Op::Add:
+                return a + b;
+            case Op::Sub:
+                return a - b;
+            case Op::Mul:
+                return a * b;
+            case Op::Div:
+                return a / b;
+            case Op::Pow:
+                return std::pow(a, b);
+            case Op::Min:
+                return std::min(a, b);
+            case Op::Max:
+                return std::max(a, b);
+            default:
+                return 0.0;
+        }
+    }
+
+    // Evaluates n <= block_size points, the result is left in the first slot of the stack
+    void evalBlock(const double *r, int n, double *stack) const {
+        int slot = -1;
+        for (const auto &ins : this->code) {
+            // Loads push a new slot, binary operations pop one
+            if (ins.op <= Op::R2) slot++;
+            if (isBinary(ins.op)) slot--;
+            double *top = stack + static_cast<size_t>(slot) * block_size;
+            switch (ins.op) {
+                case Op::Const: {
+                    const double c = ins.value;
+#pragma omp simd
+                    for (int i = 0; i < n; i++) top[i] = c;
+                    break;
+                }
+                case Op::Var: {
+                    const int d = ins.arg;
+#pragma omp simd
+                    for (int i = 0; i < n; i++) top[i] = r[i * D + d];
+                    break;
+                }
+                case Op::R:
+                case Op::R2: {
+#pragma omp simd
+                    for (int i = 0; i < n; i++) {
+                        double r2 = 0.0;
+                        for (int d = 0; d < D; d++) r2 += r[i * D + d] * r[i * D + d];
+                        top[i] = r2;
+                    }
+                    if (ins.op == Op::R) {
+#pragma omp simd
+                        for (int i = 0; i < n; i++) top[i] = std::sqrt(top[i]);
+                    }
+                    break;
+                }
+                default:
+                    if (isBinary(ins.op)) {
+                        applyBinary(ins.op, top, top + block_size, n);
+                    } else {
+                        applyUnary(ins.op, top, n);
+                    }
+            }
+        }
+    }
+
+    static void applyUnary(Op op, double *a, int n) {
+        switch (op) {
+            case Op::Neg:
+#pragma omp simd
+                for (int i = 0; i < n; i++) a[i] = -a[i];
+                break;
+            case Op::Square:
+#pragma omp simd
+                for (int i = 0; i < n; i++) a[i] = a[i] * a[i];
+                break;
+            case Op::Exp:
+#pragma omp simd
+                for (int i = 0; i < n; i++) a[i] = std::exp(a[i]);
+                break;
+            case Op::Sqrt:
+#pragma omp simd
+                for (int i = 0; i < n; i++) a[i] = std::sqrt(a[i]);
+                break;
+            case Op::Abs:
+#pragma omp simd
+                for (int i = 0; i < n; i++) a[i] = std::abs(a[i]);
+                break;
+            default:
+                for (int i = 0; i < n; i++) a[i] = apply(op, a[i], 0.0);
+        }
+    }
+
+    static void applyBinary(Op op, double *a, const double *b, int n) {
+        switch (op) {
+            case Op::Add:
+#pragma omp simd
+                for (int i = 0; i < n; i++) a[i] += b[i];
+                break;
+            case Op::Sub:
+#pragma omp simd
+                for (int i = 0; i < n; i++) a[i] -= b[i];
+                break;
+            case Op::Mul:
+#pragma omp simd
+                for (int i = 0; i < n; i++) a[i] *= b[i];
+                break;
+            case Op::Div:
+#pragma omp simd
+                for (int i = 0; i < n; i++) a[i] /= b[i];
+                break;
+            default:
+                for (int i = 0; i < n; i++) a[i] = apply(op, a[i], b[i]);
+        }
+    }
+
+    static int variable(const std::string &name) {
+        const char *names[] = {"x", "y", "z"};
+        for (int d = 0; d < D; d++) {
+            if (name == names[d]) return d;
+        }
+        return -1;
+    }
+
+    static Op unary(const std::string &name) {
+        static const std::map<std::string, Op> ops = {{"exp", Op::Exp},
+                                                      {"log", Op::Log},
+                                                      {"sqrt", Op::Sqrt},
+                                                      {"abs", Op::Abs},
+                                                      {"sin", Op::Sin},
+                                                      {"cos", Op::Cos},
+                                                      {"tan", Op::Tan},
+                                                      {"sinh", Op::Sinh},
+                                                      {"cosh", Op::Cosh},
+                                                      {"tanh", Op::Tanh},
+                                                      {"atan", Op::Atan},
+                                                      {"erf", Op::Erf},
+                                                      {"erfc", Op::Erfc}};
+        auto it = ops.find(name);
+        return (it != ops.end()) ? it->second : Op::Const;
+    }
+
+    static Op binary(const std::string &name) {
+        if (name == "pow") return Op::Pow;
+        if (name == "min") return Op::Min;
+        if (name == "max") return Op::Max;
+        return Op::Const;
+    }
+
+    // Appends an instruction, folding operations on constants
+    void emit(Op op, int arg = 0, double value = 0.0) {
+        int n = this->code.size();
+        if (op == Op::Const or op == Op::Var or op == Op::R or op == Op::R2) {
+            this->code.push_back({op, arg, value});
+            this->depth++;
+            this->maxDepth = std::max(this->maxDepth, this->depth);
+        } else if (isBinary(op)) {
+            if (n >= 2 and this->code[n - 2].op == Op::Const and this->code[n - 1].op == Op::Const) {
+                double c = apply(op, this->code[n - 2].value, this->code[n - 1].value);
+                this->code.pop_back();
+                this->code.back().value = c;
+            } else if (op == Op::Pow and this->code[n - 1].op == Op::Const and this->code[n - 1].value == 2.0) {
+                this->code.back() = {Op::Square, 0, 0.0};
+            } else {
+                this->code.push_back({op, 0, 0.0});
+            }
+            this->depth--;
+        } else if (this->code[n - 1].op == Op::Const) {
+            this->code.back().value = apply(op, this->code.back().value, 0.0);
+        } else {
+            this->code.push_back({op, 0, 0.0});
+        }
+    }
+
+    // Recursive descent parser, emitting postfix code while parsing
+    struct Parser {
+        const std::string &str;
+        size_t pos;
+        PyAnalyticFunction<D> &func;
+        int nesting{0};
+
+        // Bounds the recursion, so that deeply nested input raises instead of overflowing the stack
+        struct Nested {
+            Parser &parser;
+            explicit Nested(Parser &p)
+                    : parser(p) {
+                if (++this->parser.nesting > max_nesting) this->parser.fail("Expression is nested too deeply");
+            }
+            ~Nested() { this->parser.nesting--; }
+        };
+
+        [[noreturn]] void fail(const std::string &msg) const {
+            throw std::invalid_argument(msg + " at position " + std::to_string(this->pos) + " in expression \"" + this->str + "\"");
+        }
+
+        void skipSpace() {
+            while (this->pos < this->str.size() and std::isspace(static_cast<unsigned char>(this->str[this->pos]))) this->pos++;
+        }
+
+        bool accept(const char *token) {
+            skipSpace();
+            auto len = std::char_traits<char>::length(token);
+            if (this->str.compare(this->pos, len, token) != 0) return false;
+            this->pos += len;
+            return true;
+        }
+
+        void expect(const char *token) {
+            if (not accept(token)) fail(std::string("Expected '") + token + "'");
+        }
+
+        // expression := term (('+' | '-') term)*
+        void parseExpression() {
+            Nested nested(*this);
+            parseTerm();
+            while (true) {
+                if (accept("+")) {
+                    parseTerm();
+                    this->func.emit(Op::Add);
+                } else if (accept("-")) {
+                    parseTerm();
+                    this->func.emit(Op::Sub);
+                } else {
+                    return;
+                }
+            }
+        }
+
+        // term := unary (('*' | '/') unary)*
+        void parseTerm() {
+            parseUnary();
+            while (true) {
+                skipSpace();
+                if (this->str.compare(this->pos, 2, "**") == 0) return;
+                if (accept("*")) {
+                    parseUnary();
+                    this->func.emit(Op::Mul);
+                } else if (accept("/")) {
+                    parseUnary();
+                    this->func.emit(Op::Div);
+                } else {
+                    return;
+                }
+            }
+        }
+
+        // unary := ('-' | '+') unary | power
+        void parseUnary() {
+            Nested nested(*this);
+            if (accept("-")) {
+                parseUnary();
+                this->func.emit(Op::Neg);
+            } else if (accept("+")) {
+                parseUnary();
+            } else {
+                parsePower();
+            }
+        }
+
+        // power := primary (('^' | '**') unary)?, right associative
+        void parsePower() {
+            parsePrimary();
+            if (accept("^") or accept("**")) {
+                parseUnary();
+                this->func.emit(Op::Pow);
+            }
+        }
+
+        // primary := number | name | name '(' arguments ')' | '(' expression ')'
+        void parsePrimary() {
+            skipSpace();
+            if (this->pos >= this->str.size()) fail("Unexpected end");
+            char c = this->str[this->pos];
+            if (accept("(")) {
+                parseExpression();
+                expect(")");
+            } else if (std::isdigit(static_cast<unsigned char>(c)) or c == '.') {
+                const char *begin = this->str.c_str() + this->pos;
+                char *end = nullptr;
+                double value = std::strtod(begin, &end);
+                if (end == begin) fail("Invalid number");
+                this->pos += end - begin;
+                this->func.emit(Op::Const, 0, value);
+            } else if (std::isalpha(static_cast<unsigned char>(c)) or c == '_') {
+                size_t start = this->pos;
+                while (this->pos < this->str.size() and (std::isalnum(static_cast<unsigned char>(this->str[this->pos])) or this->str[this->pos] == '_')) this->pos++;
+                parseName(this->str.substr(start, this->pos - start));
+            } else {
+                fail("Unexpected character");
+            }
+        }
+
+        void parseName(const std::string &name) {
+            skipSpace();
+            bool call = this->pos < this->str.size() and this->str[this->pos] == '(';
+            if (call and unary(name) != Op::Const) {
+                expect("(");
+                parseExpression();
+                expect(")");
+                this->func.emit(unary(name));
+            } else if (call and binary(name) != Op::Const) {
+                expect("(");
+                parseExpression();
+                expect(",");
+                parseExpression();
+                expect(")");
+                this->func.emit(binary(name));
+            } else if (call) {
+                fail("Unknown function '" + name + "'");
+            } else if (variable(name) >= 0) {
+                this->func.emit(Op::Var, variable(name));
+            } else if (name == "r") {
+                this->func.emit(Op::R);
+            } else if (name == "r2") {
+                this->func.emit(Op::R2);
+            } else if (name == "pi") {
+                this->func.emit(Op::Const, 0, mrcpp::pi);
+            } else if (this->func.parameters.count(name) > 0) {
+                this->func.emit(Op::Const, 0, this->func.parameters.at(name));
+            } else {
+                fail("Unknown name '" + name + "'");
+            }
+        }
+    };
+};
+
+} // namespace mrcpp
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+
+namespace mrcpp {
+
+/*
+ * Interface of functions that can be evaluated in batches of points.
+ * Projections use it instead of calling evalf() once per point whenever a
+ * RepresentableFunction also implements this interface and hasBatch() is
+ * true, see batch_function().
+ */
+template <int D> class PyBatchEvaluator {
+public:
+    virtual ~PyBatchEvaluator() = default;
+
+    /** @returns False if the batch evaluation is not available after all */
+    virtual bool hasBatch() const { return true; }
+
+    /** Evaluates N points, given as a flat row-major (N, D) array */
+    virtual void evalf_batch(const std::vector<double> &pts, std::vector<double> &vals) const = 0;
+};
+
+} // namespace mrcpp
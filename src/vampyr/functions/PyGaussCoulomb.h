@@ -0,0 +1,252 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include <MRCPP/Parallel>
+#include <MRCPP/constants.h>
+#include <MRCPP/functions/GaussExp.h>
+#include <MRCPP/functions/GaussFunc.h>
+
+namespace mrcpp {
+
+/*
+ * Coulomb self energy of a large expansion of spherical Gaussians, the same
+ * quantity as GaussExp<3>::calcCoulombEnergy. As there, every term is a
+ * normalized charge distribution, and the energy of a pair is erf(sqrt(mu)R)/R
+ * with mu = a*b/(a+b), summed over all ordered pairs.
+ *
+ * The Gaussians are sorted once into a hierarchy of clusters of nearby
+ * centers. Pairs of clusters that are far apart compared to their radii, and
+ * whose Gaussians don't overlap, interact through a multipole expansion about
+ * their centroids to second order. All other pairs are summed directly, where
+ * pairs that are far apart compared to their exponents skip the erf. With
+ * tolerance tol, clusters are expanded when (r_A + r_B) < tol^(1/3) d, so the
+ * relative error of each cluster pair, and thereby of the total energy, is of
+ * the order of tol. tol = 0 sums all pairs directly.
+ */
+class PyGaussCoulomb final {
+public:
+    explicit PyGaussCoulomb(const GaussExp<3> &gexp) {
+        int nFuncs = gexp.size();
+        std::vector<double> in_exps(nFuncs);
+        std::array<std::vector<double>, 3> in_pos;
+        for (int d = 0; d < 3; d++) in_pos[d].resize(nFuncs);
+        for (int i = 0; i < nFuncs; i++) {
+            const auto &gauss = gexp.getFunc(i);
+            if (dynamic_cast<const GaussFunc<3> *>(&gauss) == nullptr) throw std::invalid_argument("Coulomb energy requires a GaussExp of GaussFunc terms");
+            const auto &beta = gauss.getExp();
+            for (int d = 0; d < 3; d++) {
+                if (gauss.getPower()[d] != 0) throw std::invalid_argument("Coulomb energy requires Gaussians with zero powers");
+                if (beta[d] != beta[0] or beta[d] <= 0.0) throw std::invalid_argument("Coulomb energy requires Gaussians with one positive exponent");
+                in_pos[d][i] = gauss.getPos()[d];
+            }
+            in_exps[i] = beta[0];
+        }
+
+        // Sort the Gaussians into clusters, and store them in cluster order
+        std::vector<int> order(nFuncs);
+        std::iota(order.begin(), order.end(), 0);
+        if (nFuncs > 0) buildCluster(order, 0, nFuncs, in_pos, in_exps);
+        this->exps.resize(nFuncs);
+        for (int d = 0; d < 3; d++) this->pos[d].resize(nFuncs);
+        for (int i = 0; i < nFuncs; i++) {
+            this->exps[i] = in_exps[order[i]];
+            for (int d = 0; d < 3; d++) this->pos[d][i] = in_pos[d][order[i]];
+        }
+    }
+
+    /** @returns The Coulomb energy, with relative error of the order of tol */
+    double energy(double tol) const {
+        if (tol < 0.0) throw std::invalid_argument("Tolerance of the Coulomb energy must be non-negative");
+        std::vector<Interaction> interactions;
+        if (not this->clusters.empty()) addSelf(0, std::cbrt(tol), tol, interactions);
+
+        double total = 0.0;
+        int nInteractions = interactions.size();
+#pragma omp parallel for schedule(dynamic) reduction(+ : total) num_threads(mrcpp_get_num_threads())
+        for (int k = 0; k < nInteractions; k++) {
+            const auto &inter = interactions[k];
+            const auto &A = this->clusters[inter.a];
+            const auto &B = this->clusters[inter.b];
+            total += inter.weight * (inter.far ? farEnergy(A, B) : nearEnergy(A, B));
+        }
+        return total;
+    }
+
+private:
+    static constexpr int leaf_size = 32;
+    // erfc(6) < 1e-16, beyond this the Gaussians interact as point charges
+    static constexpr double erf_cut = 36.0;
+
+    // Range of Gaussians around their centroid, with children or a leaf
+    struct Cluster {
+        std::array<double, 3> center;
+        std::array<double, 6> moment; // xx, yy, zz, xy, xz, yz about the centroid
+        double radius;
+        double minExp;
+        int begin;
+        int end;
+        int left;
+        int right;
+    };
+
+    // Pair of clusters, summed directly or through their multipole expansion
+    struct Interaction {
+        int a;
+        int b;
+        double weight;
+        bool far;
+    };
+
+    std::vector<Cluster> clusters;
+    std::vector<double> exps;
+    std::array<std::vector<double>, 3> pos;
+
+    // Splits the Gaussians in order[begin, end) at the median of the widest axis of their centers
+    int buildCluster(std::vector<int> &order,
+                     int begin,
+                     int end,
+                     const std::array<std::vector<double>, 3> &in_pos,
+                     const std::vector<double> &in_exps) {
+        Cluster cluster{{}, {}, 0.0, std::numeric_limits<double>::max(), begin, end, -1, -1};
+        std::array<double, 3> cmin, cmax;
+        cmin.fill(std::numeric_limits<double>::max());
+        cmax.fill(std::numeric_limits<double>::lowest());
+        cluster.center.fill(0.0);
+        cluster.moment.fill(0.0);
+        for (int i = begin; i < end; i++) {
+            int j = order[i];
+            cluster.minExp = std::min(cluster.minExp, in_exps[j]);
+            for (int d = 0; d < 3; d++) {
+                cluster.center[d] += in_pos[d][j];
+                cmin[d] = std::min(cmin[d], in_pos[d][j]);
+                cmax[d] = std::max(cmax[d], in_pos[d][j]);
+            }
+        }
+        for (int d = 0; d < 3; d++) cluster.center[d] /= (end - begin);
+        for (int i = begin; i < end; i++) {
+            int j = order[i];
+            std::array<double, 3> x;
+            for (int d = 0; d < 3; d++) x[d] = in_pos[d][j] - cluster.center[d];
+            cluster.radius = std::max(cluster.radius, std::sqrt(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]));
+            cluster.moment[0] += x[0] * x[0];
+            cluster.moment[1] += x[1] * x[1];
+            cluster.moment[2] += x[2] * x[2];
+            cluster.moment[3] += x[0] * x[1];
+            cluster.moment[4] += x[0] * x[2];
+            cluster.moment[5] += x[1] * x[2];
+        }
+        int idx = this->clusters.size();
+        this->clusters.push_back(cluster);
+        if (end - begin <= leaf_size) return idx;
+
+        int axis = 0;
+        for (int d = 1; d < 3; d++) {
+            if (cmax[d] - cmin[d] > cmax[axis] - cmin[axis]) axis = d;
+        }
+        int mid = begin + (end - begin) / 2;
+        const auto &x = in_pos[axis];
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end, [&x](int a, int b) { return x[a] < x[b]; });
+        int left = buildCluster(order, begin, mid, in_pos, in_exps);
+        int right = buildCluster(order, mid, end, in_pos, in_exps);
+        this->clusters[idx].left = left;
+        this->clusters[idx].right = right;
+        return idx;
+    }
+
+    bool isLeaf(int idx) const { return this->clusters[idx].left < 0; }
+
+    // Clusters are expanded when they are small compared to their distance, and their Gaussians don't overlap
+    bool wellSeparated(const Cluster &A, const Cluster &B, double theta, double tol) const {
+        double d2 = 0.0;
+        for (int d = 0; d < 3; d++) d2 += (B.center[d] - A.center[d]) * (B.center[d] - A.center[d]);
+        double dist = std::sqrt(d2);
+        double r = A.radius + B.radius;
+        if (r >= theta * dist) return false;
+        double mu = A.minExp * B.minExp / (A.minExp + B.minExp);
+        return std::erfc(std::sqrt(mu) * (dist - r)) < tol;
+    }
+
+    // All ordered pairs within cluster a
+    void addSelf(int a, double theta, double tol, std::vector<Interaction> &out) const {
+        if (isLeaf(a)) {
+            out.push_back({a, a, 1.0, false});
+            return;
+        }
+        int left = this->clusters[a].left;
+        int right = this->clusters[a].right;
+        addSelf(left, theta, tol, out);
+        addSelf(right, theta, tol, out);
+        addPair(left, right, 2.0, theta, tol, out);
+    }
+
+    // All pairs between the disjoint clusters a and b, splitting the larger one until they separate
+    void addPair(int a, int b, double weight, double theta, double tol, std::vector<Interaction> &out) const {
+        const auto &A = this->clusters[a];
+        const auto &B = this->clusters[b];
+        if (wellSeparated(A, B, theta, tol)) {
+            out.push_back({a, b, weight, true});
+        } else if (isLeaf(a) and isLeaf(b)) {
+            out.push_back({a, b, weight, false});
+        } else if (isLeaf(b) or (not isLeaf(a) and A.radius >= B.radius)) {
+            addPair(A.left, b, weight, theta, tol, out);
+            addPair(A.right, b, weight, theta, tol, out);
+        } else {
+            addPair(a, B.left, weight, theta, tol, out);
+            addPair(a, B.right, weight, theta, tol, out);
+        }
+    }
+
+    double nearEnergy(const Cluster &A, const Cluster &B) const {
+        const auto &x = this->pos[0];
+        const auto &y = this->pos[1];
+        const auto &z = this->pos[2];
+        const auto &a = this->exps;
+        double total = 0.0;
+        for (int i = A.begin; i < A.end; i++) {
+            double sum = 0.0;
+#pragma omp simd reduction(+ : sum)
+            for (int j = B.begin; j < B.end; j++) {
+                double dx = x[i] - x[j];
+                double dy = y[i] - y[j];
+                double dz = z[i] - z[j];
+                double r2 = dx * dx + dy * dy + dz * dz;
+                double mu = a[i] * a[j] / (a[i] + a[j]);
+                if (mu * r2 > erf_cut) {
+                    sum += 1.0 / std::sqrt(r2);
+                } else if (r2 < 1.0e-24) {
+                    sum += 2.0 * std::sqrt(mu / pi);
+                } else {
+                    double r = std::sqrt(r2);
+                    sum += std::erf(std::sqrt(mu) * r) / r;
+                }
+            }
+            total += sum;
+        }
+        return total;
+    }
+
+    // Expansion of 1/|R + u| to second order in the offsets u from the centroids, where the dipole terms vanish
+    double farEnergy(const Cluster &A, const Cluster &B) const {
+        double nA = A.end - A.begin;
+        double nB = B.end - B.begin;
+        std::array<double, 3> R;
+        for (int d = 0; d < 3; d++) R[d] = B.center[d] - A.center[d];
+        std::array<double, 6> S;
+        for (int k = 0; k < 6; k++) S[k] = nA * B.moment[k] + nB * A.moment[k];
+        double d2 = R[0] * R[0] + R[1] * R[1] + R[2] * R[2];
+        double dist = std::sqrt(d2);
+        double trS = S[0] + S[1] + S[2];
+        double RSR = R[0] * R[0] * S[0] + R[1] * R[1] * S[1] + R[2] * R[2] * S[2] +
+                     2.0 * (R[0] * R[1] * S[3] + R[0] * R[2] * S[4] + R[1] * R[2] * S[5]);
+        return nA * nB / dist + (3.0 * RSR - d2 * trS) / (2.0 * d2 * d2 * dist);
+    }
+};
+
+} // namespace mrcpp
@@ -6,19 +6,46 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 
 #include <MRCPP/functions/RepresentableFunction.h>
 
+#include "PyBatchEvaluator.h"
+#include "core/arrays.h"
+
 namespace vampyr {
 
 template <int D, typename FunctionBase = mrcpp::RepresentableFunction<D, double>>
-class PyRepresentableFunction : public FunctionBase {
+class PyRepresentableFunction : public FunctionBase, public mrcpp::PyBatchEvaluator<D> {
 public:
     /* Inherit the constructors */
     using FunctionBase::FunctionBase;
 
     double evalf(const mrcpp::Coord<D> &r) const override { PYBIND11_OVERLOAD_PURE(double, FunctionBase, evalf, r); }
+
+    // Batch evaluation is available when the Python subclass defines evalf_batch
+    bool hasBatch() const override {
+        pybind11::gil_scoped_acquire acquire;
+        return bool(pybind11::get_override(static_cast<const FunctionBase *>(this), "evalf_batch"));
+    }
+
+    // Calls evalf_batch of the Python subclass with a read-only (N, D) array of points
+    void evalf_batch(const std::vector<double> &pts, std::vector<double> &vals) const override {
+        namespace py = pybind11;
+        py::gil_scoped_acquire acquire;
+        auto override = py::get_override(static_cast<const FunctionBase *>(this), "evalf_batch");
+        if (not override) throw std::runtime_error("evalf_batch is not defined");
+        auto n = static_cast<py::ssize_t>(vals.size());
+        auto r = readonly_array(pts, {n, static_cast<py::ssize_t>(D)});
+        auto f = py::array_t<double, py::array::c_style | py::array::forcecast>::ensure(override(r));
+        if (!f || f.size() != n) throw std::runtime_error("evalf_batch must return one value per point");
+        std::copy(f.data(), f.data() + n, vals.begin());
+    }
 };
 
 } // namespace vampyr
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
+#include "PyAnalyticFunction.h"
 #include "PyRepresentableFunction.h"
 
 #include "gaussians.h"
@@ -15,11 +19,56 @@ template <int D> void functions(pybind11::module &m) {
     py::class_<RepresentableFunction<D, double>, PyRepresentableFunction<D>>(m,
                                                                      "RepresentableFunction",
                                                                      R"mydelimiter(
-       Filler text
+        Base class of analytic functions, subclassed in Python by defining evalf.
+
+        Subclasses may also define evalf_batch(self, points), taking an (N, D)
+        NumPy array of points and returning an array of N values. Projections
+        then evaluate the function once per refinement iteration instead of
+        once per point, and build the tree in parallel.
     )mydelimiter")
         .def(py::init<const std::vector<double> &, const std::vector<double> &>())
         .def("__call__", [](const RepresentableFunction<D, double> &func, const Coord<D> &r) { return func.evalf(r); });
 
+    py::class_<PyAnalyticFunction<D>, RepresentableFunction<D, double>>(m,
+                                                                       "AnalyticFunction",
+                                                                       R"mydelimiter(
+        Analytic function compiled from an expression string.
+
+        The expression may use the coordinates x, y, z (up to the dimension),
+        r and r2 (the distance from the origin and its square), the constant
+        pi, the parameters bound by name in params, the operators + - * / ^
+        (or **), and the functions exp, log, sqrt, abs, sin, cos, tan, sinh,
+        cosh, tanh, atan, erf, erfc, pow, min and max. For example::
+
+            f = AnalyticFunction("exp(-a*r2)*x", params={"a": 2.0})
+
+        The expression is parsed once into a compact bytecode, which is
+        evaluated natively in parallel, so projections of the function run on
+        all threads without calling back into Python.
+    )mydelimiter")
+        .def(py::init<const std::string &, const std::map<std::string, double> &>(),
+             "expr"_a,
+             "params"_a = std::map<std::string, double>())
+        .def_property_readonly("expr", &PyAnalyticFunction<D>::getExpression)
+        .def_property_readonly("params", &PyAnalyticFunction<D>::getParameters)
+        .def(
+            "evaluate",
+            [](const PyAnalyticFunction<D> &func, py::array_t<double, py::array::c_style | py::array::forcecast> points) {
+                bool valid = (points.ndim() == 2 and points.shape(1) == D) or (D == 1 and points.ndim() == 1);
+                if (not valid) throw py::value_error("Points must be given as an array of shape (N, D)");
+                auto nPts = points.shape(0);
+                std::vector<double> pts(points.data(), points.data() + nPts * D);
+                std::vector<double> vals(nPts);
+                {
+                    py::gil_scoped_release release;
+                    func.evalf_batch(pts, vals);
+                }
+                return py::array_t<double>(nPts, vals.data());
+            },
+            "points"_a,
+            "Evaluate the function in an (N, D) array of points.")
+        .def("__repr__", [](const PyAnalyticFunction<D> &func) { return "AnalyticFunction(\"" + func.getExpression() + "\")"; });
+
     gaussians<D>(m);
 }
 } // namespace vampyr
@@ -1,10 +1,13 @@
 #pragma once
 
+#include <pybind11/numpy.h>
+
 #include <MRCPP/functions/GaussExp.h>
 #include <MRCPP/functions/GaussFunc.h>
 #include <MRCPP/functions/GaussPoly.h>
 #include <MRCPP/functions/function_utils.h>
 
+#include "PyGaussCoulomb.h"
 #include "PyGaussian.h"
 
 namespace vampyr {
@@ -82,8 +85,8 @@ template <int D> void gaussians(pybind11::module &m) {
              Warning: power has to be a zero vector)mydelimiter");
 
     // GaussExp class
-    py::class_<GaussExp<D>, RepresentableFunction<D, double>>(m, "GaussExp")
-        .def(py::init())
+    py::class_<GaussExp<D>, RepresentableFunction<D, double>> gauss_exp(m, "GaussExp");
+    gauss_exp.def(py::init())
         .def("size", py::overload_cast<>(&GaussExp<D>::size, py::const_), "Number of Gaussians in the GaussExp")
         .def("func",
              py::overload_cast<int>(&GaussExp<D>::getFunc),
@@ -103,10 +106,69 @@ template <int D> void gaussians(pybind11::module &m) {
              "Differentiate all Gaussians in GaussExp along the specified axis")
         .def("squaredNorm", &GaussExp<D>::calcSquareNorm)
         .def("calcCoulombEnergy", &GaussExp<D>::calcCoulombEnergy)
+        .def(py::pickle(
+            [](const GaussExp<D> &func) {
+                // Stored as arrays of coefficients, exponents, positions and powers
+                auto n = static_cast<py::ssize_t>(func.size());
+                py::array_t<double> coefs(n);
+                py::array_t<double> exps({n, static_cast<py::ssize_t>(D)});
+                py::array_t<double> pos({n, static_cast<py::ssize_t>(D)});
+                py::array_t<int> pows({n, static_cast<py::ssize_t>(D)});
+                for (int i = 0; i < n; i++) {
+                    const auto &gauss = func.getFunc(i);
+                    if (dynamic_cast<const GaussFunc<D> *>(&gauss) == nullptr) throw std::runtime_error("Only GaussFunc terms can be pickled");
+                    coefs.mutable_at(i) = gauss.getCoef();
+                    for (int d = 0; d < D; d++) {
+                        exps.mutable_at(i, d) = gauss.getExp()[d];
+                        pos.mutable_at(i, d) = gauss.getPos()[d];
+                        pows.mutable_at(i, d) = gauss.getPower()[d];
+                    }
+                }
+                return py::make_tuple(coefs, exps, pos, pows);
+            },
+            [](py::tuple state) {
+                if (state.size() != 4) throw std::runtime_error("Invalid GaussExp state");
+                auto coefs = state[0].cast<py::array_t<double>>();
+                auto exps = state[1].cast<py::array_t<double>>();
+                auto pos = state[2].cast<py::array_t<double>>();
+                auto pows = state[3].cast<py::array_t<int>>();
+                GaussExp<D> func;
+                for (int i = 0; i < coefs.size(); i++) {
+                    std::array<double, D> a;
+                    std::array<int, D> p;
+                    Coord<D> r;
+                    for (int d = 0; d < D; d++) {
+                        a[d] = exps.at(i, d);
+                        r[d] = pos.at(i, d);
+                        p[d] = pows.at(i, d);
+                    }
+                    func.append(GaussFunc<D>(a, coefs.at(i), r, p));
+                }
+                return func;
+            }))
         .def("__str__", [](const GaussExp<D> &func) {
             std::ostringstream os;
             os << func;
             return os.str();
         });
+
+    if constexpr (D == 3) {
+        gauss_exp.def(
+            "calcCoulombEnergy",
+            [](const GaussExp<D> &func, double tol) {
+                PyGaussCoulomb coulomb(func);
+                py::gil_scoped_release release;
+                return coulomb.energy(tol);
+            },
+            "tol"_a,
+            R"mydelimiter(
+            Coulomb energy of the GaussExp, approximated to relative error tol.
+
+            Same energy as calcCoulombEnergy(), for large expansions of
+            Gaussians with zero powers: distant clusters of Gaussians interact
+            through a multipole expansion, and the sum runs in parallel on all
+            MRCPP threads. tol=0 sums all pairs directly.
+            )mydelimiter");
+    }
 }
 } // namespace vampyr
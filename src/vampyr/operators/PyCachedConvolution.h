@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <MRCPP/operators/ConvolutionOperator.h>
+#include <MRCPP/trees/CornerOperatorTree.h>
+#include <MRCPP/trees/MultiResolutionAnalysis.h>
+
+#include "trees/PyTreeArrays.h"
+
+namespace mrcpp {
+
+/*
+ * Convolution operator restored from an operator file written by
+ * save_convolution(), skipping the kernel fit and the operator assembly.
+ * The file also holds the operator root and reach, and a prefactor which the
+ * bindings apply to the output, to reproduce the normalization of the
+ * original operator (e.g. 1/4pi for Poisson).
+ */
+template <int D> class PyCachedConvolution final : public ConvolutionOperator<D> {
+public:
+    static std::unique_ptr<PyCachedConvolution<D>> load(const MultiResolutionAnalysis<D> &mra, std::istream &in) {
+        std::int32_t root, reach;
+        in.read(reinterpret_cast<char *>(&root), sizeof(root));
+        in.read(reinterpret_cast<char *>(&reach), sizeof(reach));
+        if (not in) throw std::runtime_error("Truncated operator file");
+        return std::unique_ptr<PyCachedConvolution<D>>(new PyCachedConvolution<D>(mra, root, reach, in));
+    }
+
+    double getPrefactor() const { return this->prefactor; }
+
+private:
+    double prefactor{1.0};
+
+    PyCachedConvolution(const MultiResolutionAnalysis<D> &mra, int root, int reach, std::istream &in)
+            : ConvolutionOperator<D>(mra, root, reach) {
+        std::int32_t nTerms;
+        double buildPrec;
+        in.read(reinterpret_cast<char *>(&buildPrec), sizeof(buildPrec));
+        in.read(reinterpret_cast<char *>(&this->prefactor), sizeof(this->prefactor));
+        in.read(reinterpret_cast<char *>(&nTerms), sizeof(nTerms));
+        this->setBuildPrec(buildPrec);
+
+        for (int i = 0; i < nTerms; i++) {
+            std::int64_t nNodes, nCoefs;
+            in.read(reinterpret_cast<char *>(&nNodes), sizeof(nNodes));
+            in.read(reinterpret_cast<char *>(&nCoefs), sizeof(nCoefs));
+            std::vector<int> scales(nNodes);
+            std::vector<int> translations(nNodes * 2);
+            std::vector<double> coefs(nNodes * nCoefs);
+            in.read(reinterpret_cast<char *>(scales.data()), scales.size() * sizeof(int));
+            in.read(reinterpret_cast<char *>(translations.data()), translations.size() * sizeof(int));
+            in.read(reinterpret_cast<char *>(coefs.data()), coefs.size() * sizeof(double));
+            if (not in) throw std::runtime_error("Truncated operator file");
+
+            auto o_tree = std::make_unique<CornerOperatorTree>(this->oper_mra, buildPrec);
+            read_tree_arrays<2>(*o_tree, nNodes, scales.data(), translations.data(), coefs.data());
+            o_tree->setupOperNodeCache();
+            this->raw_exp.push_back(std::move(o_tree));
+        }
+        this->initOperExp(nTerms);
+    }
+};
+
+/*
+ * Writes the assembled operator trees of a convolution operator, one term
+ * per separable kernel component, in the array representation of the trees.
+ */
+template <int D> void save_convolution(ConvolutionOperator<D> &oper, double prefactor, std::ostream &out) {
+    std::int32_t root = oper.getOperatorRoot();
+    std::int32_t reach = oper.getOperatorReach();
+    std::int32_t nTerms = oper.size();
+    double buildPrec = oper.getBuildPrec();
+    out.write(reinterpret_cast<const char *>(&root), sizeof(root));
+    out.write(reinterpret_cast<const char *>(&reach), sizeof(reach));
+    out.write(reinterpret_cast<const char *>(&buildPrec), sizeof(buildPrec));
+    out.write(reinterpret_cast<const char *>(&prefactor), sizeof(prefactor));
+    out.write(reinterpret_cast<const char *>(&nTerms), sizeof(nTerms));
+
+    for (int i = 0; i < nTerms; i++) {
+        auto nodes = tree_nodes<2>(oper.getComponent(i, 0));
+        std::int64_t nNodes = nodes.size();
+        std::int64_t nCoefs = nodes[0]->getNCoefs();
+        std::vector<int> scales(nNodes);
+        std::vector<int> translations(nNodes * 2);
+        std::vector<double> coefs(nNodes * nCoefs);
+        write_tree_arrays<2>(nodes, scales.data(), translations.data(), coefs.data());
+        out.write(reinterpret_cast<const char *>(&nNodes), sizeof(nNodes));
+        out.write(reinterpret_cast<const char *>(&nCoefs), sizeof(nCoefs));
+        out.write(reinterpret_cast<const char *>(scales.data()), scales.size() * sizeof(int));
+        out.write(reinterpret_cast<const char *>(translations.data()), translations.size() * sizeof(int));
+        out.write(reinterpret_cast<const char *>(coefs.data()), coefs.size() * sizeof(double));
+    }
+}
+
+/*
+ * Exact textual description of an operator: its type, kernel parameters,
+ * precision, root and reach (range), and everything defining the MRA. Floating
+ * point numbers are written in hexadecimal so the key is exact.
+ */
+template <int D>
+std::string convolution_key(const std::string &type, const MultiResolutionAnalysis<D> &mra, const std::vector<double> &params, double prec, const std::string &range) {
+    const auto &box = mra.getWorldBox();
+    const auto &basis = mra.getScalingBasis();
+    std::ostringstream os;
+    os << std::hexfloat << type << " D=" << D << " prec=" << prec << " range=" << range;
+    os << " params=";
+    for (auto p : params) os << p << ",";
+    os << " basis=" << basis.getScalingType() << "," << basis.getScalingOrder() << " depth=" << mra.getMaxDepth();
+    os << " box=" << box.getScale() << "," << box.isPeriodic();
+    for (int d = 0; d < D; d++) os << "," << box.getCornerIndex().getTranslation(d) << "," << box.size(d) << "," << box.getScalingFactor(d);
+    return os.str();
+}
+
+} // namespace mrcpp
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <pybind11/stl/filesystem.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include <unistd.h>
+
+#include "PyCachedConvolution.h"
+#include "trees/TreeLock.h"
+
+namespace vampyr {
+
+/*
+ * Process-wide cache of convolution operators, keyed on the exact operator
+ * description. Operators are shared between all lookups with the same key.
+ * With a cache directory set, the assembled operator trees are also written
+ * to disk, and later processes restore them instead of rebuilding.
+ *
+ * The cache holds Python objects and is only accessed with the GIL held.
+ * It is intentionally never destroyed, since the interpreter may be gone
+ * when static objects are destructed.
+ */
+struct OperatorCache final {
+    std::optional<std::filesystem::path> directory;
+    std::map<std::string, pybind11::object> operators;
+
+    static OperatorCache &get() {
+        static auto *cache = new OperatorCache();
+        return *cache;
+    }
+};
+
+constexpr char operator_file_magic[8] = {'V', 'A', 'M', 'P', 'O', 'P', 'E', 'R'};
+constexpr std::uint32_t operator_file_version = 1;
+
+inline std::filesystem::path operator_file_path(const std::filesystem::path &dir, const std::string &key) {
+    std::ostringstream name;
+    name << std::hex << std::hash<std::string>{}(key) << ".op";
+    return dir / name.str();
+}
+
+// Suffix of a temporary operator file, unique between processes sharing the directory and between calls
+inline std::string operator_tmp_suffix() {
+    static std::atomic<unsigned> counter{0};
+    static const auto salt = std::random_device{}();
+    std::ostringstream suffix;
+    suffix << "." << ::getpid() << "." << std::hex << salt << "." << counter++ << ".tmp";
+    return suffix.str();
+}
+
+// Root and reach part of the cache key, operators built with default range are distinct
+inline std::string operator_range(std::optional<int> root, std::optional<int> reach) {
+    if (not root or not reach) return "default";
+    return std::to_string(*root) + "," + std::to_string(*reach);
+}
+
+/*
+ * Returns the cached operator for key, otherwise restores it from the cache
+ * directory or builds it, and stores it in the cache. The build function is
+ * called with the GIL released.
+ *
+ * The operator is always returned as a CachedConvolution, whether it was
+ * built or restored, so callers see the same type regardless of the cache
+ * state. A built operator is written out and read back in memory, the same
+ * way it would be restored by a later process.
+ */
+template <int D>
+pybind11::object cached_convolution(const std::string &key,
+                                    double prefactor,
+                                    const mrcpp::MultiResolutionAnalysis<D> &mra,
+                                    const std::function<std::unique_ptr<mrcpp::ConvolutionOperator<D>>()> &build) {
+    using namespace mrcpp;
+    namespace py = pybind11;
+    namespace fs = std::filesystem;
+
+    auto &cache = OperatorCache::get();
+    auto it = cache.operators.find(key);
+    if (it != cache.operators.end()) return it->second;
+
+    std::unique_ptr<PyCachedConvolution<D>> oper;
+    if (cache.directory) {
+        auto path = operator_file_path(*cache.directory, key);
+        std::ifstream in(path, std::ios::binary);
+        char magic[8] = {};
+        std::uint32_t version = 0, length = 0;
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char *>(&version), sizeof(version));
+        in.read(reinterpret_cast<char *>(&length), sizeof(length));
+        std::string stored(in ? length : 0, '\0');
+        in.read(stored.data(), stored.size());
+        bool valid = in and std::memcmp(magic, operator_file_magic, sizeof(magic)) == 0 and version == operator_file_version and stored == key;
+        if (valid) {
+            try {
+                py::gil_scoped_release release;
+                oper = PyCachedConvolution<D>::load(mra, in);
+            } catch (std::exception &e) {
+                // Unreadable cache files are rebuilt and overwritten
+                oper.reset();
+            }
+        }
+    }
+
+    if (not oper) {
+        py::gil_scoped_release release;
+        std::stringstream data(std::ios::in | std::ios::out | std::ios::binary);
+        {
+            auto built = build();
+            save_convolution<D>(*built, prefactor, data);
+        }
+        if (cache.directory) {
+            // Written to a temporary file first, so concurrent jobs never read partial files
+            auto path = operator_file_path(*cache.directory, key);
+            auto tmp = path;
+            tmp += operator_tmp_suffix();
+            fs::create_directories(*cache.directory);
+            {
+                std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+                std::uint32_t length = key.size();
+                out.write(operator_file_magic, sizeof(operator_file_magic));
+                out.write(reinterpret_cast<const char *>(&operator_file_version), sizeof(operator_file_version));
+                out.write(reinterpret_cast<const char *>(&length), sizeof(length));
+                out.write(key.data(), key.size());
+                out << data.rdbuf();
+            }
+            fs::rename(tmp, path);
+            data.clear();
+            data.seekg(0);
+        }
+        oper = PyCachedConvolution<D>::load(mra, data);
+    }
+    auto obj = py::cast(std::move(oper));
+    cache.operators[key] = obj;
+    return obj;
+}
+
+inline void operator_cache(pybind11::module &m) {
+    namespace py = pybind11;
+    using namespace pybind11::literals;
+
+    m.def(
+        "set_operator_cache",
+        [](std::optional<std::filesystem::path> directory) { OperatorCache::get().directory = directory; },
+        "directory"_a = py::none(),
+        R"mydelimiter(
+        Set the directory where cached convolution operators are stored.
+
+        Operators created with the cached() constructors are then written to
+        this directory and restored from it by later processes, skipping the
+        kernel fit and operator assembly. With None, operators are only
+        shared within the current process. The cached() constructors return
+        a CachedConvolution in both cases.
+        )mydelimiter");
+
+    m.def(
+        "clear_operator_cache",
+        []() { OperatorCache::get().operators.clear(); },
+        "Drop all operators from the in-process cache, files on disk are kept.");
+}
+
+} // namespace vampyr
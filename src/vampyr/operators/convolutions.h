@@ -10,6 +10,11 @@
 #include <MRCPP/operators/HeatOperator.h>
 #include <MRCPP/treebuilders/apply.h>
 
+#include "cache.h"
+#include "core/Profiler.h"
+#include "treebuilders/PyApply.h"
+#include "trees/TreeLock.h"
+
 namespace vampyr {
 
 void cartesian_convolution(pybind11::module &);
@@ -26,14 +31,62 @@ template <int D> void convolutions(pybind11::module &m) {
     py::class_<ConvolutionOperator<D>>(m, "ConvolutionOperator")
         .def(py::init<const MultiResolutionAnalysis<D> &, GaussExp<1> &, double>(), "mra"_a, "kernel"_a, "prec"_a)
         .def(py::init<const MultiResolutionAnalysis<D> &, GaussExp<1> &, double, int, int>())
+        .def_static(
+            "cached",
+            [](const MultiResolutionAnalysis<D> &mra, GaussExp<1> &kernel, double prec, std::optional<int> root, std::optional<int> reach) {
+                std::vector<double> params;
+                for (int i = 0; i < kernel.size(); i++) {
+                    const auto &gauss = kernel.getFunc(i);
+                    params.insert(params.end(), {gauss.getCoef(), gauss.getExp()[0], gauss.getPos()[0], double(gauss.getPower()[0])});
+                }
+                auto key = convolution_key<D>("ConvolutionOperator", mra, params, prec, operator_range(root, reach));
+                return cached_convolution<D>(key, 1.0, mra, [&]() {
+                    if (root and reach) return std::make_unique<ConvolutionOperator<D>>(mra, kernel, prec, *root, *reach);
+                    return std::make_unique<ConvolutionOperator<D>>(mra, kernel, prec);
+                });
+            },
+            "mra"_a,
+            "kernel"_a,
+            "prec"_a,
+            "root"_a = py::none(),
+            "reach"_a = py::none(),
+            R"mydelimiter(
+            Shared instance of the operator, see set_operator_cache().
+
+            Returns the same CachedConvolution for identical arguments within a
+            process, and restores the operator from the cache directory if
+            available.
+            )mydelimiter")
+        .def(
+            "apply_many",
+            [](ConvolutionOperator<D> &C, std::vector<FunctionTree<D, double> *> inp) {
+                TreeLock lock(&C, inp);
+                ProfileScope prof("ConvolutionOperator.apply_many", inp);
+                auto out = apply_many<D>(C.getBuildPrec(), C, inp);
+                prof.output(out);
+                return out;
+            },
+            "inp"_a,
+            py::call_guard<py::gil_scoped_release>(),
+            R"mydelimiter(
+            Apply the operator to a list of trees, returns the list of results.
+
+            The trees are processed concurrently in a single parallel region,
+            one tree per thread, sharing the operator band widths. This is
+            faster than separate calls when there are many trees.
+            )mydelimiter")
         .def(
             "__call__",
             [](ConvolutionOperator<D> &C, FunctionTree<D, double> *inp) {
-                auto out = std::make_unique<FunctionTree<D, double>>(inp->getMRA());
-                apply<D, double>(C.getBuildPrec(), *out, C, *inp);
+                TreeLock lock(&C, inp);
+                ProfileScope prof("ConvolutionOperator.__call__", inp);
+                auto out = make_tree<D>(inp->getMRA());
+                prof.output(out);
+                apply_tree<D>(C.getBuildPrec(), *out, C, *inp);
                 return out;
             },
-            "inp"_a);
+            "inp"_a,
+            py::call_guard<py::gil_scoped_release>());
 
     py::class_<IdentityConvolution<D>, ConvolutionOperator<D>>(m, "IdentityConvolution")
         .def(py::init<const MultiResolutionAnalysis<D> &, double>(), "mra"_a, "prec"_a)
@@ -45,11 +98,42 @@ template <int D> void convolutions(pybind11::module &m) {
         .def(
             "__call__",
             [](IdentityConvolution<D> &I, FunctionTree<D, double> *inp) {
-                auto out = std::make_unique<FunctionTree<D, double>>(inp->getMRA());
-                apply<D, double>(I.getBuildPrec(), *out, I, *inp);
+                TreeLock lock(&I, inp);
+                ProfileScope prof("IdentityConvolution.__call__", inp);
+                auto out = make_tree<D>(inp->getMRA());
+                prof.output(out);
+                apply_tree<D>(I.getBuildPrec(), *out, I, *inp);
                 return out;
             },
-            "inp"_a);
+            "inp"_a,
+            py::call_guard<py::gil_scoped_release>());
+
+    py::class_<PyCachedConvolution<D>, ConvolutionOperator<D>>(m, "CachedConvolution")
+        .def("prefactor", &PyCachedConvolution<D>::getPrefactor)
+        .def(
+            "apply_many",
+            [](PyCachedConvolution<D> &C, std::vector<FunctionTree<D, double> *> inp) {
+                TreeLock lock(&C, inp);
+                ProfileScope prof("CachedConvolution.apply_many", inp);
+                auto out = apply_many<D>(C.getBuildPrec(), C, inp, C.getPrefactor());
+                prof.output(out);
+                return out;
+            },
+            "inp"_a,
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "__call__",
+            [](PyCachedConvolution<D> &C, FunctionTree<D, double> *inp) {
+                TreeLock lock(&C, inp);
+                ProfileScope prof("CachedConvolution.__call__", inp);
+                auto out = make_tree<D>(inp->getMRA());
+                prof.output(out);
+                apply_tree<D>(C.getBuildPrec(), *out, C, *inp);
+                if (C.getPrefactor() != 1.0) out->rescale(C.getPrefactor());
+                return out;
+            },
+            "inp"_a,
+            py::call_guard<py::gil_scoped_release>());
 
     if constexpr (D == 3) cartesian_convolution(m);
     if constexpr (D == 3) helmholtz_operator(m);
@@ -68,12 +152,22 @@ void cartesian_convolution(pybind11::module &m) {
         .def(
             "__call__",
             [](CartesianConvolution &O, FunctionTree<3, double> *inp) {
-                auto out = std::make_unique<FunctionTree<3, double>>(inp->getMRA());
-                apply<3, double>(O.getBuildPrec(), *out, O, *inp);
+                TreeLock lock(&O, inp);
+                ProfileScope prof("CartesianConvolution.__call__", inp);
+                auto out = make_tree<3>(inp->getMRA());
+                prof.output(out);
+                apply_tree<3>(O.getBuildPrec(), *out, O, *inp);
                 return out;
             },
-            "inp"_a)
-        .def("setCartesianComponents", &CartesianConvolution::setCartesianComponents);
+            "inp"_a,
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "setCartesianComponents",
+            [](CartesianConvolution &O, int x, int y, int z) {
+                TreeLock lock(&O);
+                O.setCartesianComponents(x, y, z);
+            },
+            py::call_guard<py::gil_scoped_release>());
 }
 
 void poisson_operator(pybind11::module &m) {
@@ -88,15 +182,44 @@ void poisson_operator(pybind11::module &m) {
              "prec"_a,
              "root"_a = 0,
              "reach"_a = 1)
+        .def_static(
+            "cached",
+            [](const MultiResolutionAnalysis<3> &mra, double prec, std::optional<int> root, std::optional<int> reach) {
+                auto key = convolution_key<3>("PoissonOperator", mra, {}, prec, operator_range(root, reach));
+                return cached_convolution<3>(key, 1.0 / (4.0 * mrcpp::pi), mra, [&]() -> std::unique_ptr<ConvolutionOperator<3>> {
+                    if (root and reach) return std::make_unique<PoissonOperator>(mra, prec, *root, *reach);
+                    return std::make_unique<PoissonOperator>(mra, prec);
+                });
+            },
+            "mra"_a,
+            "prec"_a,
+            "root"_a = py::none(),
+            "reach"_a = py::none(),
+            "Shared instance of the operator as a CachedConvolution, see set_operator_cache().")
+        .def(
+            "apply_many",
+            [](PoissonOperator &P, std::vector<FunctionTree<3, double> *> inp) {
+                TreeLock lock(&P, inp);
+                ProfileScope prof("PoissonOperator.apply_many", inp);
+                auto out = apply_many<3>(P.getBuildPrec(), P, inp, 1.0 / (4.0 * mrcpp::pi));
+                prof.output(out);
+                return out;
+            },
+            "inp"_a,
+            py::call_guard<py::gil_scoped_release>())
         .def(
             "__call__",
             [](PoissonOperator &P, FunctionTree<3, double> *inp) {
-                auto out = std::make_unique<FunctionTree<3, double>>(inp->getMRA());
-                apply<3, double>(P.getBuildPrec(), *out, P, *inp);
+                TreeLock lock(&P, inp);
+                ProfileScope prof("PoissonOperator.__call__", inp);
+                auto out = make_tree<3>(inp->getMRA());
+                prof.output(out);
+                apply_tree<3>(P.getBuildPrec(), *out, P, *inp);
                 out->rescale(1.0 / (4.0 * mrcpp::pi));
                 return out;
             },
-            "inp"_a);
+            "inp"_a,
+            py::call_guard<py::gil_scoped_release>());
 }
 
 void helmholtz_operator(pybind11::module &m) {
@@ -112,15 +235,45 @@ void helmholtz_operator(pybind11::module &m) {
              "prec"_a,
              "root"_a = 0,
              "reach"_a = 1)
+        .def_static(
+            "cached",
+            [](const MultiResolutionAnalysis<3> &mra, double exp, double prec, std::optional<int> root, std::optional<int> reach) {
+                auto key = convolution_key<3>("HelmholtzOperator", mra, {exp}, prec, operator_range(root, reach));
+                return cached_convolution<3>(key, 1.0 / (4.0 * mrcpp::pi), mra, [&]() -> std::unique_ptr<ConvolutionOperator<3>> {
+                    if (root and reach) return std::make_unique<HelmholtzOperator>(mra, exp, prec, *root, *reach);
+                    return std::make_unique<HelmholtzOperator>(mra, exp, prec);
+                });
+            },
+            "mra"_a,
+            "exp"_a,
+            "prec"_a,
+            "root"_a = py::none(),
+            "reach"_a = py::none(),
+            "Shared instance of the operator as a CachedConvolution, see set_operator_cache().")
+        .def(
+            "apply_many",
+            [](HelmholtzOperator &H, std::vector<FunctionTree<3, double> *> inp) {
+                TreeLock lock(&H, inp);
+                ProfileScope prof("HelmholtzOperator.apply_many", inp);
+                auto out = apply_many<3>(H.getBuildPrec(), H, inp, 1.0 / (4.0 * mrcpp::pi));
+                prof.output(out);
+                return out;
+            },
+            "inp"_a,
+            py::call_guard<py::gil_scoped_release>())
         .def(
             "__call__",
             [](HelmholtzOperator &H, FunctionTree<3, double> *inp) {
-                auto out = std::make_unique<FunctionTree<3, double>>(inp->getMRA());
-                apply<3, double>(H.getBuildPrec(), *out, H, *inp);
+                TreeLock lock(&H, inp);
+                ProfileScope prof("HelmholtzOperator.__call__", inp);
+                auto out = make_tree<3>(inp->getMRA());
+                prof.output(out);
+                apply_tree<3>(H.getBuildPrec(), *out, H, *inp);
                 out->rescale(1.0 / (4.0 * mrcpp::pi));
                 return out;
             },
-            "inp"_a);
+            "inp"_a,
+            py::call_guard<py::gil_scoped_release>());
 }
 
 
@@ -147,11 +300,15 @@ void time_evolution_operator(pybind11::module &m)
         .def(
             "__call__",
             [](TimeEvolutionOperator<1> &T, FunctionTree<1, double> *inp) {
-                auto out = std::make_unique<FunctionTree<1, double>>(inp->getMRA());
-                apply<1, double>(T.getBuildPrec(), *out, T, *inp);
+                TreeLock lock(&T, inp);
+                ProfileScope prof("TimeEvolutionOperator.__call__", inp);
+                auto out = make_tree<1>(inp->getMRA());
+                prof.output(out);
+                apply_tree<1>(T.getBuildPrec(), *out, T, *inp);
                 return out;
             },
-            "inp"_a);
+            "inp"_a,
+            py::call_guard<py::gil_scoped_release>());
 }
 
 
@@ -169,11 +326,15 @@ void heat_operator(pybind11::module &m)
         .def(
             "__call__",
             [](HeatOperator<1> &T, FunctionTree<1, double> *inp) {
-                auto out = std::make_unique<FunctionTree<1, double>>(inp->getMRA());
-                apply<1, double>(T.getBuildPrec(), *out, T, *inp);
+                TreeLock lock(&T, inp);
+                ProfileScope prof("HeatOperator.__call__", inp);
+                auto out = make_tree<1>(inp->getMRA());
+                prof.output(out);
+                apply_tree<1>(T.getBuildPrec(), *out, T, *inp);
                 return out;
             },
-            "inp"_a);
+            "inp"_a,
+            py::call_guard<py::gil_scoped_release>());
 }
 
 } // namespace vampyr
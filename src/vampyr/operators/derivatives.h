@@ -6,6 +6,10 @@
 #include <MRCPP/operators/BSOperator.h>
 #include <MRCPP/operators/PHOperator.h>
 
+#include "core/Profiler.h"
+#include "trees/PyTreePool.h"
+#include "trees/TreeLock.h"
+
 namespace vampyr {
 
 template <int D> void derivatives(pybind11::module &m) {
@@ -25,12 +29,16 @@ template <int D> void derivatives(pybind11::module &m) {
         .def(
             "__call__",
             [](DerivativeOperator<D> &oper, FunctionTree<D, double> *inp, int axis) {
-                auto out = std::make_unique<FunctionTree<D, double>>(inp->getMRA());
+                TreeLock lock(&oper, inp);
+                ProfileScope prof("DerivativeOperator.__call__", inp);
+                auto out = make_tree<D>(inp->getMRA());
+                prof.output(out);
                 apply(*out, oper, *inp, axis);
                 return out;
             },
             "inp"_a,
-            "axis"_a = 0);
+            "axis"_a = 0,
+            py::call_guard<py::gil_scoped_release>());
 
     py::class_<ABGVOperator<D>, DerivativeOperator<D>>(m,
                                                        "ABGVDerivative",
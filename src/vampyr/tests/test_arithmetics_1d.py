@@ -1,6 +1,10 @@
+import json
+import operator
+
 import numpy as np
 import pytest
 
+from vampyr import profile
 from vampyr import vampyr1d as vp
 
 epsilon = 1.0e-3
@@ -216,3 +220,223 @@ def test_OverloadedOperators():
     tree_14 = vp.prod(tree_vec_2)
     assert tree_14.nNodes() > tree_1.nNodes()
     assert tree_14.integrate() == pytest.approx(ref_norm, rel=epsilon)
+
+
+def test_ConcurrentThreads():
+    from concurrent.futures import ThreadPoolExecutor
+
+    tree_1 = vp.FunctionTree(mra)
+    vp.advanced.build_grid(out=tree_1, inp=gauss)
+    vp.advanced.project(prec=epsilon, out=tree_1, inp=gauss)
+    ref_norm = tree_1.squaredNorm()
+
+    def work(c):
+        # independent output trees, shared input tree
+        tree = c * tree_1
+        return (tree * tree_1).integrate()
+
+    coefs = [float(i) for i in range(1, 9)]
+    with ThreadPoolExecutor(max_workers=4) as pool:
+        results = list(pool.map(work, coefs))
+
+    for c, res in zip(coefs, results):
+        assert res == pytest.approx(c * ref_norm, rel=epsilon)
+
+
+def test_InPlaceOperators():
+    tree_1 = vp.FunctionTree(mra)
+    vp.advanced.build_grid(out=tree_1, inp=gauss)
+    vp.advanced.project(prec=epsilon, out=tree_1, inp=gauss)
+    ref_int = tree_1.integrate()
+    ref_norm = tree_1.squaredNorm()
+    ref_nodes = tree_1.nNodes()
+
+    tree_2 = vp.FunctionTree(mra)
+    vp.advanced.build_grid(out=tree_2, scales=1)
+    tree_2.setZero()
+    tree_2_id = id(tree_2)
+
+    tree_2 += tree_1
+    assert id(tree_2) == tree_2_id
+    assert tree_2.nNodes() == ref_nodes
+    assert tree_2.integrate() == pytest.approx(ref_int, rel=epsilon)
+
+    tree_2 -= 0.5 * tree_1
+    assert id(tree_2) == tree_2_id
+    assert tree_2.integrate() == pytest.approx(0.5 * ref_int, rel=epsilon)
+
+    tree_2 *= 4.0
+    tree_2 /= 2.0
+    assert id(tree_2) == tree_2_id
+    assert tree_2.nNodes() == ref_nodes
+    assert tree_2.integrate() == pytest.approx(ref_int, rel=epsilon)
+
+    tree_2 += tree_2
+    assert tree_2.integrate() == pytest.approx(2.0 * ref_int, rel=epsilon)
+
+    tree_2 *= tree_1
+    assert id(tree_2) == tree_2_id
+    assert tree_2.nNodes() > ref_nodes
+    assert tree_2.integrate() == pytest.approx(2.0 * ref_norm, rel=epsilon)
+
+    tree_3 = tree_1.deepCopy()
+    tree_3 **= 2.0
+    assert tree_3.nNodes() > ref_nodes
+    assert tree_3.integrate() == pytest.approx(ref_norm, rel=epsilon)
+
+    tree_3 -= tree_3
+    assert tree_3.squaredNorm() == 0.0
+
+
+def test_InPlaceOperatorsDeepOperand():
+    narrow = vp.GaussFunc(alpha=1.0, beta=1.0e4, position=r0)
+    deep = vp.FunctionTree(mra)
+    vp.advanced.build_grid(out=deep, inp=narrow)
+    vp.advanced.project(prec=epsilon, out=deep, inp=narrow)
+
+    # Pure scaling projection on the root nodes
+    broad = vp.GaussFunc(alpha=1.0, beta=0.1, position=r0)
+    root = vp.ScalingProjector(mra, N)(broad)
+    assert deep.depth() > root.depth() + 2
+
+    for op, iop in [(operator.add, operator.iadd), (operator.sub, operator.isub), (operator.mul, operator.imul)]:
+        ref = op(root, deep)
+        lhs = iop(root.deepCopy(), deep)
+        assert lhs.nNodes() == ref.nNodes()
+        assert (lhs - ref).norm() < epsilon * ref.norm()
+
+
+def test_LazyExpression():
+    tree_1 = vp.FunctionTree(mra)
+    vp.advanced.build_grid(out=tree_1, inp=gauss)
+    vp.advanced.project(prec=epsilon, out=tree_1, inp=gauss)
+    tree_2 = 2.0 * tree_1
+    ref_int = tree_1.integrate()
+    ref_norm = tree_1.squaredNorm()
+
+    expr = vp.lazy(tree_1) + 2.0 * vp.lazy(tree_2) - vp.lazy(tree_1) * tree_2
+    assert isinstance(expr, vp.Expression)
+    assert expr.nTerms() == 3
+    assert expr.degree() == 2
+
+    ref = tree_1 + 2.0 * tree_2 - tree_1 * tree_2
+    out = expr.materialize()
+    assert out.nNodes() == ref.nNodes()
+    assert out.integrate() == pytest.approx(ref.integrate(), rel=epsilon)
+    assert out.integrate() == pytest.approx(5.0 * ref_int - 2.0 * ref_norm, rel=epsilon)
+
+    # equal terms are collected
+    expr = vp.lazy(tree_1) - vp.lazy(tree_1) / 2.0
+    assert expr.nTerms() == 1
+    assert expr.materialize().integrate() == pytest.approx(0.5 * ref_int, rel=epsilon)
+
+    out = (vp.lazy(tree_1) ** 2).materialize()
+    assert out.integrate() == pytest.approx(ref_norm, rel=epsilon)
+
+
+def test_OverlapMatrix():
+    trees = []
+    for x in [0.6, 0.8, 1.2]:
+        func = vp.GaussFunc(alpha=alpha, beta=beta, position=[x])
+        tree = vp.FunctionTree(mra)
+        vp.advanced.build_grid(out=tree, inp=func)
+        vp.advanced.project(prec=epsilon, out=tree, inp=func)
+        trees.append(tree)
+
+    S = vp.overlap_matrix(trees)
+    assert S.shape == (3, 3)
+    assert np.allclose(S, S.T)
+    for i, bra in enumerate(trees):
+        for j, ket in enumerate(trees):
+            assert S[i, j] == pytest.approx(vp.dot(bra, ket), rel=epsilon)
+
+    T = vp.overlap_matrix(trees[:2], trees)
+    assert T.shape == (2, 3)
+    assert np.allclose(T, S[:2, :], rtol=epsilon)
+
+    I = vp.IdentityConvolution(mra, prec=epsilon)
+    U = vp.overlap_matrix(trees, oper=I)
+    assert np.allclose(U, S, rtol=10 * epsilon)
+
+    # Smooth kernel, with large contributions from the coarse scales
+    kexp = vp.GaussExp()
+    kexp.append(vp.GaussFunc(alpha=1.0, beta=1.0))
+    K = vp.ConvolutionOperator(mra, kexp, prec=epsilon)
+    V = vp.overlap_matrix(trees, oper=K)
+    for i, bra in enumerate(trees):
+        for j, ket in enumerate(trees):
+            assert V[i, j] == pytest.approx(vp.dot(bra, K(ket)), rel=1.0e-10)
+
+
+def test_Rotate():
+    trees = []
+    for x in [0.6, 0.8, 1.2]:
+        func = vp.GaussFunc(alpha=alpha, beta=beta, position=[x])
+        tree = vp.FunctionTree(mra)
+        vp.advanced.build_grid(out=tree, inp=func)
+        vp.advanced.project(prec=epsilon, out=tree, inp=func)
+        trees.append(tree)
+
+    U = np.array([[1.0, 0.5], [-2.0, 0.0], [0.0, 3.0]])
+    outs = vp.rotate(trees, U)
+    assert len(outs) == 2
+    for j, out in enumerate(outs):
+        ref = vp.sum([(U[i, j], tree) for i, tree in enumerate(trees)])
+        assert out.integrate() == pytest.approx(ref.integrate(), rel=epsilon)
+        assert out.squaredNorm() == pytest.approx(ref.squaredNorm(), rel=epsilon)
+
+    # Orthonormalization with S^(-1/2)
+    S = vp.overlap_matrix(trees)
+    w, v = np.linalg.eigh(S)
+    orth = vp.rotate(trees, v @ np.diag(w ** -0.5) @ v.T)
+    assert np.allclose(vp.overlap_matrix(orth), np.eye(3), atol=epsilon)
+
+    with pytest.raises(ValueError):
+        vp.rotate(trees, U.T)
+
+
+def test_StreamingDot():
+    bras, kets = [], []
+    # The narrow pair is several levels finer than the others
+    for x, b in [(0.6, beta), (0.8, beta), (1.2, 1.0e4), (1.6, beta)]:
+        for vec, c in [(bras, 1.0), (kets, 2.0)]:
+            func = vp.GaussFunc(alpha=c * alpha, beta=b, position=[x])
+            tree = vp.FunctionTree(mra)
+            vp.advanced.build_grid(out=tree, inp=func)
+            vp.advanced.project(prec=epsilon, out=tree, inp=func)
+            vec.append(tree)
+
+    out = vp.dot(bras, kets)
+    ref = vp.sum([bra * ket for bra, ket in zip(bras, kets)])
+    assert out.nNodes() == ref.nNodes()
+    assert out.squaredNorm() == pytest.approx(ref.squaredNorm(), rel=epsilon)
+    assert (out - ref).norm() < epsilon * ref.norm()
+    assert out.integrate() == pytest.approx(ref.integrate(), rel=epsilon)
+    assert out.integrate() == pytest.approx(np.trace(vp.overlap_matrix(bras, kets)), rel=epsilon)
+    assert vp.dot(bras, kets[:2]) is None
+
+
+def test_Profile():
+    tree = vp.FunctionTree(mra)
+    vp.advanced.build_grid(out=tree, inp=gauss)
+    vp.advanced.project(prec=epsilon, out=tree, inp=gauss)
+
+    out = tree * tree
+    assert len(profile()) == 0
+    with profile() as p:
+        out = tree + tree
+        out *= 2.0
+    tree + tree  # not recorded
+
+    records = p.records()
+    assert [r["name"] for r in records] == ["FunctionTree.__add__", "FunctionTree.__imul__"]
+    assert records[0]["inp_nodes"] == 2 * tree.nNodes()
+    assert records[0]["out_nodes"] == out.nNodes()
+    assert records[0]["bytes"] > 0
+    assert records[1]["bytes"] == 0
+    assert all(r["wall"] >= 0.0 and r["threads"] >= 1 for r in records)
+    assert "FunctionTree.__add__" in p.table()
+
+    trace = json.loads(p.chrome_trace())
+    assert len(trace["traceEvents"]) == 2
+    assert trace["traceEvents"][0]["args"]["out_nodes"] == out.nNodes()
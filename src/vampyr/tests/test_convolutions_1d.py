@@ -1,6 +1,7 @@
 import numpy as np
 import pytest
 
+from vampyr import clear_operator_cache, set_operator_cache
 from vampyr import vampyr1d as vp
 
 epsilon = 1.0e-3
@@ -37,6 +38,59 @@ def test_GaussKernel():
     assert gtree2.integrate() == pytest.approx(ftree.integrate(), rel=epsilon)
 
 
+def test_ApplyMany():
+    I = vp.IdentityConvolution(mra, prec=epsilon)
+
+    trees = []
+    for x in [0.4, 0.8, 1.2]:
+        gauss = vp.GaussFunc(alpha=alpha, beta=beta, position=[x])
+        tree = vp.FunctionTree(mra)
+        vp.advanced.build_grid(out=tree, inp=gauss)
+        vp.advanced.project(prec=epsilon, out=tree, inp=gauss)
+        trees.append(tree)
+    trees.append(trees[0])
+
+    outs = I.apply_many(trees)
+    assert len(outs) == len(trees)
+    for tree, out in zip(trees, outs):
+        ref = I(tree)
+        assert out.nNodes() == ref.nNodes()
+        assert out.norm() == pytest.approx(ref.norm(), rel=epsilon)
+    assert outs[3] is not outs[0]
+    assert I.apply_many([]) == []
+
+
+def test_OperatorCache(tmp_path):
+    beta = 1.0e5
+    alpha = (beta / np.pi) ** (1.0 / 2.0)
+    iexp = vp.GaussExp()
+    iexp.append(vp.GaussFunc(alpha=alpha, beta=beta))
+
+    ftree = vp.FunctionTree(mra)
+    vp.advanced.build_grid(out=ftree, inp=ffunc)
+    vp.advanced.project(prec=epsilon, out=ftree, inp=ffunc)
+
+    I = vp.ConvolutionOperator.cached(mra, iexp, prec=epsilon)
+    assert isinstance(I, vp.CachedConvolution)
+    assert vp.ConvolutionOperator.cached(mra, iexp, prec=epsilon) is I
+    assert vp.ConvolutionOperator.cached(mra, iexp, prec=epsilon / 10) is not I
+
+    set_operator_cache(tmp_path)
+    clear_operator_cache()
+    J = vp.ConvolutionOperator.cached(mra, iexp, prec=epsilon)
+    assert J is not I
+    assert len(list(tmp_path.iterdir())) == 1
+
+    # A new process would restore the operator from disk
+    clear_operator_cache()
+    K = vp.ConvolutionOperator.cached(mra, iexp, prec=epsilon)
+    assert isinstance(K, vp.CachedConvolution)
+    assert K(ftree).integrate() == pytest.approx(J(ftree).integrate(), rel=epsilon)
+
+    set_operator_cache(None)
+    clear_operator_cache()
+
+
 def test_Identity():
     I = vp.IdentityConvolution(mra, prec=epsilon)
 
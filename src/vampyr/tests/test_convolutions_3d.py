@@ -1,6 +1,7 @@
 import numpy as np
 import pytest
 
+from vampyr import clear_operator_cache, set_operator_cache
 from vampyr import vampyr1d as vp1
 from vampyr import vampyr3d as vp
 
@@ -87,6 +88,24 @@ def test_Poisson():
     assert vp.dot(gtree2, ftree) == pytest.approx(ref_energy, rel=epsilon)
 
 
+def test_PoissonApplyMany():
+    P = vp.PoissonOperator(mra, prec=epsilon)
+
+    gfunc = vp.GaussFunc(alpha=alpha, beta=beta, position=[1.2, 0.8, 0.6])
+    gtree = vp.FunctionTree(mra)
+    vp.advanced.build_grid(out=gtree, inp=gfunc)
+    vp.advanced.project(prec=epsilon, out=gtree, inp=gfunc)
+
+    trees = [ftree, gtree, ftree]
+    outs = P.apply_many(trees)
+    assert len(outs) == len(trees)
+    for tree, out in zip(trees, outs):
+        ref = P(tree)
+        assert out.nNodes() == ref.nNodes()
+        assert (out - ref).norm() < 1.0e-12 * ref.norm()
+        assert vp.dot(out, tree) == pytest.approx(vp.dot(ref, tree), rel=1.0e-12)
+
+
 def test_Helmholtz():
     H = vp.HelmholtzOperator(mra, exp=mu, prec=epsilon)
 
@@ -98,6 +117,42 @@ def test_Helmholtz():
     assert vp.dot(gtree2, ftree) == pytest.approx(ref_energy, rel=epsilon)
 
 
+def check_operator_cache(tmp_path, ref, cached):
+    # Built and restored operators are the same type, with the 1/4pi prefactor
+    set_operator_cache(tmp_path)
+    clear_operator_cache()
+    J = cached()
+    assert isinstance(J, vp.CachedConvolution)
+    assert J.prefactor() == pytest.approx(1.0 / (4.0 * np.pi))
+    assert len(list(tmp_path.iterdir())) == 1
+
+    clear_operator_cache()
+    K = cached()
+    assert K is not J
+    assert isinstance(K, vp.CachedConvolution)
+    assert K.prefactor() == J.prefactor()
+
+    for C in [J, K]:
+        out = C(ftree)
+        assert out.nNodes() == ref.nNodes()
+        assert (out - ref).norm() < 1.0e-12 * ref.norm()
+        out = C.apply_many([ftree])[0]
+        assert (out - ref).norm() < 1.0e-12 * ref.norm()
+
+    set_operator_cache(None)
+    clear_operator_cache()
+
+
+def test_PoissonCache(tmp_path):
+    ref = vp.PoissonOperator(mra, prec=epsilon)(ftree)
+    check_operator_cache(tmp_path, ref, lambda: vp.PoissonOperator.cached(mra, prec=epsilon))
+
+
+def test_HelmholtzCache(tmp_path):
+    ref = vp.HelmholtzOperator(mra, exp=mu, prec=epsilon)(ftree)
+    check_operator_cache(tmp_path, ref, lambda: vp.HelmholtzOperator.cached(mra, exp=mu, prec=epsilon))
+
+
 def test_PeriodicIdentity():
     world = vp.BoundingBox(pbc=True, corner=[-1, -1, -1], nboxes=[2, 2, 2])
     pbc = vp.MultiResolutionAnalysis(box=world, order=k)
@@ -1,6 +1,7 @@
 import numpy as np
 import pytest
 
+from vampyr import MapKernel, MapKernelType
 from vampyr import vampyr1d as vp
 
 L = 1
@@ -40,3 +41,42 @@ def test_FunctionMapOperator():
     g_tree = G(f_tree)
     assert g_tree.norm() == pytest.approx(g_ref.norm(), rel=epsilon)
     assert g_tree(r_0) == pytest.approx(g_ref(r_0), rel=epsilon)
+
+
+def test_FunctionMapVectorized():
+    G = vp.FunctionMap(fmap=np.square, prec=epsilon, vectorized=True)
+    g_tree = G(f_tree)
+    assert g_tree.norm() == pytest.approx(g_ref.norm(), rel=epsilon)
+    assert g_tree(r_0) == pytest.approx(g_ref(r_0), rel=epsilon)
+
+    h_tree = vp.FunctionTree(mra)
+    vp.advanced.map(prec=epsilon, out=h_tree, inp=f_tree, fmap=lambda x: x * x, vectorized=True)
+    assert h_tree(r_0) == pytest.approx(g_ref(r_0), rel=epsilon)
+
+    with pytest.raises(Exception):
+        vp.FunctionMap(fmap=np.sum, prec=epsilon, vectorized=True)(f_tree)
+
+
+def test_MapKernel():
+    x = np.array([-2.0, -0.5, 0.0, 0.25, 4.0])
+    assert MapKernel("exp")(x) == pytest.approx(np.exp(x))
+    assert MapKernel(MapKernelType.Abs)(x) == pytest.approx(np.abs(x))
+    assert MapKernel("inverse", [0.3])(x) == pytest.approx([-0.5, -2.0, 0.0, 0.0, 0.25])
+
+    K = MapKernel("clamp", [0.0]) >> MapKernel("pow", [0.5])
+    assert K(x) == pytest.approx(np.sqrt(np.maximum(x, 0.0)))
+    assert K.then(MapKernel("scale", [2.0]))(x) == pytest.approx(2.0 * np.sqrt(np.maximum(x, 0.0)))
+
+    with pytest.raises(Exception):
+        MapKernel("tanh")
+    with pytest.raises(Exception):
+        MapKernel("pow")
+
+    G = vp.FunctionMap(fmap=MapKernel("pow", [2.0]), prec=epsilon)
+    g_tree = G(f_tree)
+    assert g_tree.norm() == pytest.approx(g_ref.norm(), rel=epsilon)
+    assert g_tree(r_0) == pytest.approx(g_ref(r_0), rel=epsilon)
+
+    h_tree = vp.FunctionTree(mra)
+    vp.advanced.map(prec=epsilon, out=h_tree, inp=f_tree, fmap="abs")
+    assert h_tree(r_0) == pytest.approx(abs(r_0[0]), rel=epsilon)
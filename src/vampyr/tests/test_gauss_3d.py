@@ -1,3 +1,5 @@
+import pickle
+
 import numpy as np
 import pytest
 
@@ -80,6 +82,19 @@ def test_GaussExp():
     assert fexp(r0) == pytest.approx(ref, rel=numprec)
 
 
+def test_GaussExpPickle():
+    f0 = vp.GaussFunc(beta=10.0, alpha=2.0, position=[0.1, 0.1, 0.1], poly_exponent=[1, 0, 2])
+    f1 = vp.GaussFunc(beta=20.0, position=[-0.1, -0.1, -0.1])
+    fexp = vp.GaussExp()
+    fexp.append(f0)
+    fexp.append(f1)
+    gexp = pickle.loads(pickle.dumps(fexp))
+    assert gexp.size() == 2
+    assert gexp.func(term=0).pow(dim=2) == 2
+    assert gexp.func(term=1).exp() == 20.0
+    assert gexp([0.2, 0.0, 0.1]) == pytest.approx(fexp([0.2, 0.0, 0.1]), rel=numprec)
+
+
 def test_GaussExpEnergy():
     b0 = 10.0
     b1 = 20.0
@@ -97,6 +112,21 @@ def test_GaussExpEnergy():
     assert fexp.calcCoulombEnergy() == pytest.approx(ref, rel=numprec)
 
 
+def test_GaussExpScreenedEnergy():
+    # Well separated groups of Gaussians, which interact through multipoles
+    rng = np.random.default_rng(7)
+    fexp = vp.GaussExp()
+    for center in 60.0 * np.array([[0, 0, 0], [1, 0, 0], [0, 1, 0], [0, 0, 1], [1, 1, 1], [-1, 0, 1]]):
+        for beta, pos in zip(rng.uniform(1.0, 100.0, 100), rng.uniform(-0.5, 0.5, (100, 3))):
+            fexp.append(vp.GaussFunc(beta=beta, position=center + pos))
+    ref = fexp.calcCoulombEnergy()
+    assert fexp.calcCoulombEnergy(tol=0.0) == pytest.approx(ref, rel=numprec)
+    assert fexp.calcCoulombEnergy(tol=1.0e-4) == pytest.approx(ref, rel=1.0e-4)
+
+    with pytest.raises(ValueError):
+        fexp.calcCoulombEnergy(tol=-1.0)
+
+
 def test_GaussExpNorm():
     b0 = 10.0
     b1 = 20.0
@@ -1,6 +1,10 @@
+import pickle
+from concurrent.futures import ThreadPoolExecutor
+
 import numpy as np
 import pytest
 
+from vampyr import profile
 from vampyr import vampyr1d as vp
 
 epsilon = 1.0e-3
@@ -179,3 +183,241 @@ def test_BuildProjectSemiPeriodicGaussExp():
     vp.advanced.build_grid(out=tree_2, inp=pexp)
     vp.advanced.project(out=tree_2, inp=pexp)
     assert tree_2.integrate() == pytest.approx(2.0, rel=epsilon)
+
+
+def test_VectorizedProject():
+    def vfunc(r):
+        R2 = np.sum((r - r0) ** 2, axis=1)
+        return alpha * np.exp(-beta * R2)
+
+    tree_1 = vp.FunctionTree(mra)
+    vp.advanced.project(prec=epsilon, out=tree_1, inp=func)
+
+    tree_2 = vp.FunctionTree(mra)
+    vp.advanced.project(prec=epsilon, out=tree_2, inp=vfunc, vectorized=True)
+    assert tree_2.nNodes() == tree_1.nNodes()
+    assert tree_2.integrate() == pytest.approx(tree_1.integrate(), rel=epsilon)
+
+    P = vp.ScalingProjector(mra, prec=epsilon)
+    tree_3 = P(vfunc, vectorized=True)
+    assert tree_3.nNodes() == tree_1.nNodes()
+    assert tree_3.norm() == pytest.approx(tree_1.norm(), rel=epsilon)
+
+    with pytest.raises(RuntimeError):
+        P(lambda r: np.zeros(1), vectorized=True)
+
+    # The points are a read-only view of the batch buffer
+    def write(r):
+        r[:] = 0.0
+        return r[:, 0]
+
+    with pytest.raises(ValueError):
+        P(write, vectorized=True)
+
+
+def test_VectorizedProjectOfTree():
+    src = vp.FunctionTree(mra)
+    vp.advanced.build_grid(out=src, inp=gauss)
+    vp.advanced.project(prec=epsilon, out=src, inp=gauss)
+
+    # The callbacks lock src while their output trees are locked
+    def project_src(scale):
+        out = vp.FunctionTree(mra)
+        vp.advanced.project(prec=epsilon, out=out, inp=lambda r: scale * src.evaluate(r), vectorized=True)
+        return out
+
+    with ThreadPoolExecutor(max_workers=2) as pool:
+        outs = list(pool.map(project_src, [1.0, 2.0, 3.0, 4.0]))
+    for scale, out in zip([1.0, 2.0, 3.0, 4.0], outs):
+        assert out.integrate() == pytest.approx(scale * src.integrate(), rel=epsilon)
+
+
+def test_PointwiseProjectAndMap():
+    def n_threads():
+        tree = vp.ZeroTree(mra)
+        with profile() as p:
+            tree + tree
+        return p.records()[0]["threads"]
+
+    def bad(r):
+        raise ValueError("bad point")
+
+    src = vp.FunctionTree(mra)
+    vp.advanced.build_grid(out=src, inp=gauss)
+    vp.advanced.project(prec=epsilon, out=src, inp=gauss)
+
+    # Errors in the callbacks are raised, and leave the thread count unchanged
+    threads = n_threads()
+    with pytest.raises(ValueError):
+        vp.ScalingProjector(mra, prec=epsilon)(bad)
+    with pytest.raises(ValueError):
+        vp.advanced.map(prec=epsilon, out=vp.FunctionTree(mra), inp=src, fmap=bad)
+    assert n_threads() == threads
+
+    # Per-point callbacks on several threads, locking src while their outputs are locked
+    def project_src(scale):
+        out = vp.FunctionTree(mra)
+        vp.advanced.project(prec=epsilon, out=out, inp=lambda r: scale * src(r))
+        return vp.FunctionMap(lambda x: 2.0 * x, prec=epsilon)(out)
+
+    with ThreadPoolExecutor(max_workers=2) as pool:
+        outs = list(pool.map(project_src, [1.0, 2.0, 3.0, 4.0]))
+    for scale, out in zip([1.0, 2.0, 3.0, 4.0], outs):
+        assert out.integrate() == pytest.approx(2.0 * scale * src.integrate(), rel=epsilon)
+
+
+def test_EvaluatePoints():
+    tree = vp.FunctionTree(mra)
+    vp.advanced.build_grid(out=tree, inp=gauss)
+    vp.advanced.project(prec=epsilon, out=tree, inp=gauss)
+
+    points = np.linspace(-2.0, 5.0, 101).reshape(-1, 1)
+    values = tree.evaluate(points)
+    assert values.shape == (101,)
+    for r, v in zip(points, values):
+        assert v == pytest.approx(tree(r), abs=1.0e-12)
+    assert tree.nGenNodes() == 0
+
+    fast = tree.evaluate(points, fast=True)
+    assert np.allclose(fast, values, atol=10 * epsilon)
+
+
+def test_EvaluatePeriodicPoints():
+    sfac = [np.pi / 3]
+    periodic_world = vp.BoundingBox(scaling=sfac, pbc=True)
+    pbc = vp.MultiResolutionAnalysis(box=periodic_world, order=k)
+    pgauss = gauss.periodify(period=sfac, std_dev=6.0)
+
+    tree = vp.FunctionTree(pbc)
+    vp.advanced.build_grid(out=tree, inp=pgauss)
+    vp.advanced.project(prec=epsilon, out=tree, inp=pgauss)
+
+    # Points in several periods on both sides of the world box
+    points = np.linspace(-3.0, 4.0, 101).reshape(-1, 1)
+    values = tree.evaluate(points)
+    for r, v in zip(points, values):
+        assert v == pytest.approx(tree(r), abs=1.0e-12)
+    shifted = tree.evaluate(points + sfac[0])
+    assert np.allclose(shifted, values, atol=1.0e-10)
+
+
+def test_TreeArrays():
+    tree_1 = vp.FunctionTree(mra)
+    vp.advanced.build_grid(out=tree_1, inp=gauss)
+    vp.advanced.project(prec=epsilon, out=tree_1, inp=gauss)
+
+    scales, translations, coefs = tree_1.toArrays()
+    assert scales.shape == (tree_1.nNodes(),)
+    assert translations.shape == (tree_1.nNodes(), 1)
+    assert coefs.shape == (tree_1.nNodes(), 2 * (k + 1))
+
+    tree_2 = vp.FunctionTree(mra)
+    tree_2.fromArrays(scales, translations, coefs)
+    assert tree_2.nNodes() == tree_1.nNodes()
+    assert tree_2.nEndNodes() == tree_1.nEndNodes()
+    assert tree_2.squaredNorm() == pytest.approx(tree_1.squaredNorm(), rel=epsilon)
+    assert tree_2.integrate() == pytest.approx(tree_1.integrate(), rel=epsilon)
+
+    # Branch nodes are recomputed, so rows may be omitted or come in any order
+    rows = np.arange(tree_1.nRootNodes(), tree_1.nNodes())[::-1]
+    tree_3 = vp.FunctionTree(mra)
+    tree_3.fromArrays(scales[rows], translations[rows], coefs[rows])
+    assert tree_3.nNodes() == tree_1.nNodes()
+    assert tree_3.integrate() == pytest.approx(tree_1.integrate(), rel=epsilon)
+
+
+def test_TreeFile(tmp_path):
+    tree_1 = vp.FunctionTree(mra)
+    vp.advanced.build_grid(out=tree_1, inp=gauss)
+    vp.advanced.project(prec=epsilon, out=tree_1, inp=gauss)
+
+    path = vp.TreeFile.write(tree_1, str(tmp_path / "gauss.mwtree"))
+    file = vp.TreeFile(str(path))
+    assert file.nNodes() == tree_1.nNodes()
+    assert file.order() == k
+    assert file.indexTable().shape == (tree_1.nNodes(), 2)
+
+    tree_2 = vp.FunctionTree(mra)
+    file.load(tree_2)
+    assert tree_2.nNodes() == tree_1.nNodes()
+    assert tree_2.squaredNorm() == pytest.approx(tree_1.squaredNorm(), rel=epsilon)
+
+    # Truncation to a coarser scale drops the finer wavelet contributions
+    tree_3 = vp.FunctionTree(mra)
+    file.load(tree_3, max_scale=tree_1.rootScale() + 2)
+    assert tree_3.depth() <= 3
+    assert tree_3.nNodes() < tree_1.nNodes()
+    assert tree_3.norm() <= tree_1.norm()
+
+    # The subtree covering [0, 2) holds all of the Gaussian
+    idx = vp.NodeIndex(scale=-1, translation=[0])
+    tree_4 = vp.FunctionTree(mra)
+    file.load(tree_4, root=idx)
+    assert tree_4.integrate() == pytest.approx(tree_1.integrate(), rel=epsilon)
+    assert tree_4([2.5]) == 0.0
+
+    # Same order and root scale, but a shifted world box
+    shifted = vp.MultiResolutionAnalysis(box=vp.BoundingBox(scale=N, corner=[-1], nboxes=[2]), order=k)
+    with pytest.raises(RuntimeError):
+        file.load(vp.FunctionTree(shifted))
+
+    # Truncated and corrupt files are rejected when opened
+    data = path.read_bytes()
+    truncated = tmp_path / "truncated.mwtree"
+    for end in (40, 120, len(data) - 8):
+        truncated.write_bytes(data[:end])
+        with pytest.raises(ValueError):
+            vp.TreeFile(str(truncated))
+
+    corrupt = tmp_path / "corrupt.mwtree"
+    corrupt.write_bytes(data[:40] + (2**62).to_bytes(8, "little") + data[48:])
+    with pytest.raises(ValueError):
+        vp.TreeFile(str(corrupt))
+
+
+def test_Pickle():
+    tree_1 = vp.FunctionTree(mra, "gauss")
+    vp.advanced.build_grid(out=tree_1, inp=gauss)
+    vp.advanced.project(prec=epsilon, out=tree_1, inp=gauss)
+
+    buffers = []
+    data = pickle.dumps(tree_1, protocol=5, buffer_callback=buffers.append)
+    assert len(buffers) > 0
+
+    tree_2 = pickle.loads(data, buffers=buffers)
+    assert tree_2.name() == "gauss"
+    assert tree_2.MRA() == mra
+    assert tree_2.nNodes() == tree_1.nNodes()
+    assert tree_2.squaredNorm() == pytest.approx(tree_1.squaredNorm(), rel=epsilon)
+
+    tree_3 = pickle.loads(pickle.dumps(tree_1))
+    assert tree_3.integrate() == pytest.approx(tree_1.integrate(), rel=epsilon)
+
+
+class BatchGauss(vp.RepresentableFunction):
+    def __init__(self):
+        super().__init__([0.0], [4.0])
+        self.calls = 0
+        self.batch_calls = 0
+
+    def evalf(self, r):
+        self.calls += 1
+        return func(r)
+
+    def evalf_batch(self, points):
+        self.batch_calls += 1
+        return alpha * np.exp(-beta * np.sum((points - r0) ** 2, axis=1))
+
+
+def test_ProjectBatchRepresentableFunction():
+    f = BatchGauss()
+    P_eps = vp.ScalingProjector(mra, epsilon)
+    tree = P_eps(f)
+    assert f.calls == 0
+    assert f.batch_calls > 0
+    assert tree.integrate() == pytest.approx(1.0, rel=epsilon)
+    assert tree(r0) == pytest.approx(P_eps(gauss)(r0), rel=epsilon)
+
+    P_s = vp.ScalingProjector(mra, s)
+    assert P_s(f)(r0) == pytest.approx(P_s(gauss)(r0))
+    assert f.calls == 0
@@ -181,3 +181,63 @@ def test_BuildProjectSemiPeriodicGaussExp():
     vp.advanced.build_grid(out=tree_2, inp=pexp)
     vp.advanced.project(out=tree_2, inp=pexp)
     assert tree_2.integrate() == pytest.approx(2.0, rel=epsilon)
+
+
+def test_ProjectAnalyticFunction():
+    params = {"a": alpha, "b": beta, "x0": r0[0], "y0": r0[1], "z0": r0[2]}
+    f = vp.AnalyticFunction("a * exp(-b * ((x - x0)^2 + (y - y0)**2 + (z - z0)^2))", params=params)
+    assert f(r0) == pytest.approx(alpha)
+    assert f([0.5, 0.7, 0.9]) == pytest.approx(func([0.5, 0.7, 0.9]))
+
+    pts = np.array([[0.1, 0.2, 0.3], [0.8, 0.8, 0.8], [-1.0, 0.5, 2.0]])
+    assert f.evaluate(pts) == pytest.approx([func(p) for p in pts])
+
+    P_eps = vp.ScalingProjector(mra, epsilon)
+    tree = P_eps(f)
+    assert tree.integrate() == pytest.approx(1.0, rel=epsilon)
+
+    out = vp.FunctionTree(mra)
+    vp.advanced.build_grid(out=out, scales=s)
+    vp.advanced.project(prec=epsilon, out=out, inp=f)
+    assert out.integrate() == pytest.approx(1.0, rel=epsilon)
+
+    g = vp.AnalyticFunction("sqrt(r2) - r + 2 * pi")
+    assert g([1.0, 2.0, 3.0]) == pytest.approx(2.0 * np.pi)
+
+    with pytest.raises(ValueError):
+        vp.AnalyticFunction("exp(-a*r2)")
+    with pytest.raises(ValueError):
+        vp.AnalyticFunction("foo(x)")
+    with pytest.raises(ValueError):
+        vp.AnalyticFunction("x +")
+    with pytest.raises(ValueError):
+        vp.AnalyticFunction("x", params={"r": 1.0})
+    with pytest.raises(ValueError):
+        vp.AnalyticFunction("(" * 100000 + "x" + ")" * 100000)
+    with pytest.raises(ValueError):
+        vp.AnalyticFunction("-" * 100000 + "x")
+    with pytest.raises(ValueError):
+        vp.AnalyticFunction("x" + "^x" * 100000)
+    assert vp.AnalyticFunction("(" * 50 + "-x" + ")" * 50)([1.0, 0.0, 0.0]) == -1.0
+
+
+def test_ProjectLargeGaussExp():
+    # Narrow, normalized Gaussians on a lattice, most of them far from any given node
+    b = 50.0
+    a = (b / np.pi) ** (D / 2.0)
+    centers = [[0.5 + 0.75 * i, 0.5 + 0.75 * j, 0.5 + 0.75 * l] for i in range(4) for j in range(4) for l in range(4)]
+    gexp = vp.GaussExp()
+    for c in centers:
+        gexp.append(vp.GaussFunc(beta=b, alpha=a, position=c))
+    assert gexp.size() == 64
+
+    P_eps = vp.ScalingProjector(mra, epsilon)
+    tree = P_eps(gexp)
+    assert tree.integrate() == pytest.approx(64.0, rel=epsilon)
+    assert tree(centers[21]) == pytest.approx(gexp(centers[21]), rel=epsilon)
+    assert tree([1.1, 2.3, 0.9]) == pytest.approx(gexp([1.1, 2.3, 0.9]), rel=epsilon, abs=epsilon)
+
+    out = vp.FunctionTree(mra)
+    vp.advanced.build_grid(out=out, inp=gexp)
+    vp.advanced.project(prec=epsilon, out=out, inp=gexp)
+    assert out.integrate() == pytest.approx(64.0, rel=epsilon)
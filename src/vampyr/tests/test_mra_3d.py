@@ -1,3 +1,5 @@
+import pickle
+
 import numpy as np
 import pytest
 
@@ -55,3 +57,13 @@ def test_MRA():
     assert mra.maxScale() == 19
     assert mra.world() == world
     assert mra.basis() == interpol
+
+
+def test_Pickle():
+    world = vp.BoundingBox(scale=-1, corner=[-1, -2, -3], nboxes=[2, 4, 6])
+    assert pickle.loads(pickle.dumps(world)) == world
+
+    legendre = LegendreBasis(order=5)
+    mra = vp.MultiResolutionAnalysis(box=world, basis=legendre, max_depth=20)
+    assert pickle.loads(pickle.dumps(mra)) == mra
+    assert pickle.loads(pickle.dumps(mra)) != vp.MultiResolutionAnalysis(box=world, order=5, max_depth=20)
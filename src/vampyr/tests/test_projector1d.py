@@ -1,3 +1,4 @@
+import numpy as np
 import pytest
 
 from vampyr import vampyr1d as vp
@@ -16,3 +17,35 @@ def test_ScalingProjector():
 
     with pytest.raises(Exception):
         P_wavelet(f)
+
+
+def test_FixedScaleProjection():
+    def f(x):
+        return np.exp(-10.0 * (x[0] - 0.4) ** 2)
+
+    mra = vp.MultiResolutionAnalysis(box=[0, 1], order=7)
+    s_tree = vp.ScalingProjector(mra, 2)(f)
+    w_tree = vp.WaveletProjector(mra, 2)(f)
+
+    assert s_tree.depth() == 3
+    assert s_tree.nEndNodes() == 4
+    assert w_tree.nEndNodes() == 4
+    assert vp.dot(s_tree, w_tree) == pytest.approx(0.0, abs=1.0e-12)
+
+    sw_tree = s_tree + w_tree
+    assert sw_tree.squaredNorm() == pytest.approx(s_tree.squaredNorm() + w_tree.squaredNorm())
+    assert sw_tree([0.3]) == pytest.approx(f([0.3]), rel=1.0e-6)
+
+
+def test_FixedScaleProjectionMatchesAdaptive():
+    def f(x):
+        return np.exp(-10.0 * (x[0] - 0.4) ** 2)
+
+    mra = vp.MultiResolutionAnalysis(box=[0, 1], order=7)
+    ref_tree = vp.ScalingProjector(mra, 1.0e-12)(f)
+    s_tree = vp.ScalingProjector(mra, 3)(f)
+    w_tree = vp.WaveletProjector(mra, 3)(f)
+
+    # The fixed-scale parts are orthogonal projections of the function
+    assert vp.dot(s_tree, ref_tree) == pytest.approx(s_tree.squaredNorm(), rel=1.0e-10)
+    assert vp.dot(w_tree, ref_tree) == pytest.approx(w_tree.squaredNorm(), rel=1.0e-10)
@@ -202,3 +202,52 @@ def test_LebesgueIterator():
 
     assert gen_count == tree.nGenNodes()
     assert node_count == tree.nNodes()
+
+
+def test_CoefficientViews():
+    import numpy as np
+
+    tree.setZero()
+    node = tree.fetchEndNode(0)
+    coefs = node.coefs()
+    assert coefs.shape == (two_d * kp1_d,)
+    assert np.all(coefs == 0.0)
+
+    coefs[0] = 1.0
+    assert np.asarray(node)[0] == 1.0
+    node.calcNorms()
+    assert node.scalingNorm() == 1.0
+    assert tree.calcSquareNorm() == 1.0
+
+    chunks = tree.coefChunks()
+    assert sum(chunk.shape[0] for chunk in chunks) >= tree.nNodes()
+    assert chunks[0].shape[1] == two_d * kp1_d
+
+    # Unused slots may hold stale data, so only the rows of the end nodes are summed
+    rows = []
+    for i in range(tree.nEndNodes()):
+        addr = tree.fetchEndNode(i).coefs().__array_interface__["data"][0]
+        for chunk in chunks:
+            offset = addr - chunk.__array_interface__["data"][0]
+            if 0 <= offset < chunk.nbytes:
+                rows.append(chunk[offset // chunk.strides[0]])
+    assert len(rows) == tree.nEndNodes()
+    assert np.sum(rows) == 1.0
+
+    chunks[0][:] = 0.0
+    assert np.all(coefs == 0.0)
+    tree.setZero()
+
+
+def test_CoefficientChunksAfterCrop():
+    gauss = vp.GaussFunc(beta=100.0, position=r0)
+    ftree = vp.FunctionTree(mra)
+    vp.advanced.build_grid(out=ftree, scales=6)
+    vp.advanced.project(out=ftree, inp=gauss)
+
+    pre_crop = ftree.coefChunks()
+    ftree.crop(prec=1.0e-3)
+    chunks = ftree.coefChunks()
+    assert len(chunks) == len(pre_crop)
+    assert all(chunk.shape == pre_crop[0].shape for chunk in chunks)
+    assert sum(chunk.shape[0] for chunk in chunks) >= ftree.nNodes()
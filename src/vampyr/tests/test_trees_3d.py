@@ -1,4 +1,14 @@
-from vampyr import BottomUp, Hilbert, Lebesgue, TopDown
+from vampyr import (
+    BottomUp,
+    Hilbert,
+    Lebesgue,
+    TopDown,
+    memory_usage,
+    reset_memory_peak,
+    set_tree_pool,
+    track_memory,
+    trim_tree_pool,
+)
 from vampyr import vampyr3d as vp
 
 r0 = [0.1, 0.1, 0.1]
@@ -198,3 +208,67 @@ def test_LebesgueIterator():
 
     assert gen_count == tree.nGenNodes()
     assert node_count == tree.nNodes()
+
+
+def test_Memory():
+    big = vp.FunctionTree(mra)
+    vp.advanced.build_grid(out=big, scales=2)
+    big.setZero()
+    mem = big.memory()
+    assert mem["allocated"] == mem["nodes"] + mem["coefs"] + mem["gen_nodes"]
+    assert mem["used"] > 0
+    assert mem["unused"] == mem["allocated"] - mem["used"]
+
+    usage = memory_usage()
+    assert usage["current"] >= mem["allocated"]
+    assert usage["peak"] >= usage["current"]
+
+    copy = big.deepCopy()
+    assert memory_usage()["current"] == usage["current"] + copy.memory()["allocated"]
+    assert memory_usage()["trees"] == usage["trees"] + 1
+    del copy
+    assert memory_usage()["current"] == usage["current"]
+    assert memory_usage()["trees"] == usage["trees"]
+
+    reset_memory_peak()
+    track_memory(True)
+    try:
+        out = big + big
+        del out
+    finally:
+        track_memory(False)
+    usage = memory_usage()
+    assert usage["operations"]["FunctionTree.__add__"] >= 2 * mem["used"]
+    assert usage["peak"] >= usage["operations"]["FunctionTree.__add__"]
+
+    # The product tree of the list dot is freed before it returns, but is sampled
+    base = memory_usage()["current"]
+    reset_memory_peak()
+    track_memory(True)
+    try:
+        out = vp.dot([big], [big])
+        out_bytes = out.memory()["allocated"]
+        del out
+    finally:
+        track_memory(False)
+    assert memory_usage()["operations"]["dot"] > base + out_bytes
+
+
+def test_TreePool():
+    big = vp.FunctionTree(mra)
+    vp.advanced.build_grid(out=big, scales=2)
+    big.setZero()
+    ref = big + big
+    set_tree_pool(2)
+    try:
+        out = big + big
+        del out
+        assert memory_usage()["pooled"] > 0
+        out = big + big
+        assert out.nEndNodes() == ref.nEndNodes()
+        assert out.squaredNorm() == ref.squaredNorm()
+        del out
+        trim_tree_pool()
+        assert memory_usage()["pooled"] == 0
+    finally:
+        set_tree_pool(0)
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <MRCPP/operators/ConvolutionOperator.h>
+#include <MRCPP/treebuilders/OperApplicationCalculator.h>
+#include <MRCPP/treebuilders/TreeBuilder.h>
+#include <MRCPP/treebuilders/WaveletAdaptor.h>
+#include <MRCPP/treebuilders/grid.h>
+#include <MRCPP/trees/FunctionTree.h>
+
+#include "core/Profiler.h"
+#include "trees/PyTreePool.h"
+
+namespace mrcpp {
+
+/*
+ * Same steps as mrcpp::apply once the band widths of the operator are
+ * computed. The memory is sampled in the given profile scope while the
+ * GenNodes of the input, usually the largest temporary of the application,
+ * are still allocated.
+ */
+template <int D>
+void apply_built(double prec,
+                 FunctionTree<D, double> &out,
+                 ConvolutionOperator<D> &oper,
+                 FunctionTree<D, double> &inp,
+                 int maxIter,
+                 bool absPrec,
+                 const vampyr::ProfileScope *scope) {
+    WaveletAdaptor<D, double> adaptor(prec, out.getMRA().getMaxScale(), absPrec);
+    OperApplicationCalculator<D, double> calculator(0, prec, oper, inp);
+    TreeBuilder<D, double> builder;
+    builder.build(out, calculator, adaptor, maxIter);
+    out.mwTransform(TopDown, false); // add coarse scale contributions
+    out.mwTransform(BottomUp);
+    out.calcSquareNorm();
+    if (scope != nullptr) scope->sample(&out, &inp);
+    inp.deleteGenerated();
+}
+
+/** Same as mrcpp::apply, sampling the memory of the calling thread's profile scope before the GenNodes are deleted */
+template <int D>
+void apply_tree(double prec, FunctionTree<D, double> &out, ConvolutionOperator<D> &oper, FunctionTree<D, double> &inp, int maxIter = -1, bool absPrec = false) {
+    oper.calcBandWidths(prec);
+    apply_built<D>(prec, out, oper, inp, maxIter, absPrec, vampyr::ProfileScope::current());
+    oper.clearBandWidths();
+}
+
+/*
+ * Applies a convolution operator to a list of trees, equivalent to calling
+ * apply() on each of them and rescaling the outputs by the prefactor.
+ *
+ * The band widths of the operator are computed once up front. With at least
+ * as many trees as threads, the trees are distributed over the threads of a
+ * single parallel region, each tree being built by one thread, which scales
+ * with the number of trees rather than with the work available per tree.
+ * Shorter lists are applied one tree at a time with the parallel builder.
+ * Repeated inputs are only applied once, since trees cannot be shared between
+ * threads.
+ */
+template <int D>
+std::vector<PyTreePtr<D>>
+apply_many(double prec, ConvolutionOperator<D> &oper, const std::vector<FunctionTree<D, double> *> &inp, double prefactor = 1.0) {
+    int nTrees = inp.size();
+    std::vector<PyTreePtr<D>> out(nTrees);
+    if (nTrees == 0) return out;
+
+    // First occurrence of every input tree
+    std::vector<int> first(nTrees);
+    for (int i = 0; i < nTrees; i++) first[i] = std::find(inp.begin(), inp.begin() + i + 1, inp[i]) - inp.begin();
+
+    // The scope of the calling thread, also sampled by the threads of the parallel region
+    const auto *scope = vampyr::ProfileScope::current();
+    auto apply_one = [&](int i) {
+        out[i] = make_tree<D>(inp[i]->getMRA());
+        apply_built<D>(prec, *out[i], oper, *inp[i], -1, false, scope);
+        if (prefactor != 1.0) out[i]->rescale(prefactor);
+    };
+
+    oper.calcBandWidths(prec);
+    int nThreads = mrcpp_get_num_threads();
+    if (nTrees < nThreads) {
+        for (int i = 0; i < nTrees; i++) {
+            if (first[i] == i) apply_one(i);
+        }
+    } else {
+#pragma omp parallel for schedule(dynamic) num_threads(nThreads)
+        for (int i = 0; i < nTrees; i++) {
+            if (first[i] == i) apply_one(i);
+        }
+    }
+    oper.clearBandWidths();
+
+    for (int i = 0; i < nTrees; i++) {
+        if (first[i] == i) continue;
+        out[i] = make_tree<D>(inp[i]->getMRA());
+        copy_grid(*out[i], *out[first[i]]);
+        copy_func(*out[i], *out[first[i]]);
+    }
+    return out;
+}
+
+} // namespace mrcpp
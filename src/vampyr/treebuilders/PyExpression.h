@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <MRCPP/treebuilders/TreeBuilder.h>
+#include <MRCPP/treebuilders/WaveletAdaptor.h>
+#include <MRCPP/treebuilders/grid.h>
+
+#include "PyExpressionCalculator.h"
+#include "core/Profiler.h"
+#include "trees/PyTreePool.h"
+
+namespace mrcpp {
+
+/*
+ * Unevaluated arithmetic expression of function trees, stored as an
+ * expanded sum of products. Evaluation builds the union grid of all trees
+ * once and computes the whole expression in a single pass over its nodes.
+ */
+template <int D> class PyExpression final {
+public:
+    explicit PyExpression(FunctionTree<D, double> &tree) { this->terms.push_back({1.0, {&tree}}); }
+
+    PyExpression<D> operator+(const PyExpression<D> &rhs) const {
+        PyExpression<D> out(*this);
+        out.terms.insert(out.terms.end(), rhs.terms.begin(), rhs.terms.end());
+        out.simplify();
+        return out;
+    }
+
+    PyExpression<D> operator*(double c) const {
+        PyExpression<D> out(*this);
+        for (auto &term : out.terms) term.coef *= c;
+        return out;
+    }
+
+    PyExpression<D> operator*(const PyExpression<D> &rhs) const {
+        PyExpression<D> out(*this);
+        out.terms.clear();
+        for (const auto &a : this->terms) {
+            for (const auto &b : rhs.terms) {
+                PyExpressionTerm<D> term{a.coef * b.coef, a.factors};
+                term.factors.insert(term.factors.end(), b.factors.begin(), b.factors.end());
+                out.terms.push_back(term);
+            }
+        }
+        out.simplify();
+        return out;
+    }
+
+    PyTreePtr<D> operator()(double prec = -1.0, int maxIter = -1, bool absPrec = false) const {
+        auto trees = getTrees();
+        auto out = make_tree<D>(trees[0]->getMRA());
+
+        // Union grid with one extra refinement per multiplication
+        FunctionTreeVector<D, double> vec;
+        for (auto *tree : trees) vec.push_back({1.0, tree});
+        build_grid(*out, vec);
+        if (getDegree() > 1) build_grid(*out, getDegree() - 1);
+
+        TreeBuilder<D, double> builder;
+        WaveletAdaptor<D, double> adaptor(prec, out->getMRA().getMaxScale(), absPrec);
+        PyExpressionCalculator<D> calculator(this->terms);
+        builder.build(*out, calculator, adaptor, maxIter);
+
+        out->mwTransform(BottomUp);
+        out->calcSquareNorm();
+        vampyr::sample_memory(out, trees);
+        for (auto *tree : trees) tree->deleteGenerated();
+        return out;
+    }
+
+    /** @returns The distinct trees entering the expression */
+    std::vector<FunctionTree<D, double> *> getTrees() const {
+        std::vector<FunctionTree<D, double> *> trees;
+        for (const auto &term : this->terms) {
+            for (auto *tree : term.factors) {
+                if (std::find(trees.begin(), trees.end(), tree) == trees.end()) trees.push_back(tree);
+            }
+        }
+        return trees;
+    }
+
+    /** @returns The largest number of factors in a term */
+    int getDegree() const {
+        size_t degree = 0;
+        for (const auto &term : this->terms) degree = std::max(degree, term.factors.size());
+        return static_cast<int>(degree);
+    }
+
+    int getNTerms() const { return this->terms.size(); }
+
+private:
+    std::vector<PyExpressionTerm<D>> terms;
+
+    // Collects terms with the same factors
+    void simplify() {
+        std::vector<PyExpressionTerm<D>> merged;
+        for (auto term : this->terms) {
+            std::sort(term.factors.begin(), term.factors.end(), std::less<>());
+            auto it = std::find_if(merged.begin(), merged.end(), [&term](const auto &t) { return t.factors == term.factors; });
+            if (it != merged.end()) {
+                it->coef += term.coef;
+            } else {
+                merged.push_back(term);
+            }
+        }
+        this->terms = merged;
+    }
+};
+
+} // namespace mrcpp
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+
+#include <MRCPP/treebuilders/TreeCalculator.h>
+#include <MRCPP/trees/FunctionTree.h>
+#include <MRCPP/trees/MWNode.h>
+
+namespace mrcpp {
+
+// A term c * f_1 * f_2 * ... of an expression, linear terms have a single factor
+template <int D> struct PyExpressionTerm {
+    double coef;
+    std::vector<FunctionTree<D, double> *> factors;
+};
+
+/*
+ * Computes a sum of products of trees node by node. Product terms are
+ * evaluated in value space at the child quadrature points, as in MRCPP's
+ * MultiplicationCalculator, and accumulated before a single transform back
+ * to MW coefficients. Linear terms are then added directly in coefficient
+ * space, as in the AdditionCalculator.
+ */
+template <int D> class PyExpressionCalculator final : public TreeCalculator<D, double> {
+public:
+    explicit PyExpressionCalculator(const std::vector<PyExpressionTerm<D>> &t)
+            : terms(t) {}
+
+private:
+    std::vector<PyExpressionTerm<D>> terms;
+
+    void calcNode(MWNode<D, double> &node_o) override {
+        node_o.zeroCoefs();
+        const NodeIndex<D> &idx = node_o.getNodeIndex();
+        double *coefs_o = node_o.getCoefs();
+        int n_coefs = node_o.getNCoefs();
+
+        bool has_products = false;
+        std::vector<double> prod(n_coefs);
+        for (const auto &term : this->terms) {
+            if (term.factors.size() < 2) continue;
+            for (int j = 0; j < n_coefs; j++) prod[j] = term.coef;
+            for (auto *func_i : term.factors) {
+                // This generates missing nodes
+                MWNode<D, double> node_i = func_i->getNode(idx); // Copy node
+                node_i.mwTransform(Reconstruction);
+                node_i.cvTransform(Forward);
+                const double *vals_i = node_i.getCoefs();
+                for (int j = 0; j < n_coefs; j++) prod[j] *= vals_i[j];
+            }
+            for (int j = 0; j < n_coefs; j++) coefs_o[j] += prod[j];
+            has_products = true;
+        }
+        if (has_products) {
+            node_o.cvTransform(Backward);
+            node_o.mwTransform(Compression);
+        }
+
+        for (const auto &term : this->terms) {
+            if (term.factors.size() != 1) continue;
+            const MWNode<D, double> &node_i = term.factors[0]->getNode(idx);
+            const double *coefs_i = node_i.getCoefs();
+            for (int j = 0; j < node_i.getNCoefs(); j++) coefs_o[j] += term.coef * coefs_i[j];
+        }
+        node_o.setHasCoefs();
+        node_o.calcNorms();
+    }
+};
+
+} // namespace mrcpp
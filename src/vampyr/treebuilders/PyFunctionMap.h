@@ -2,27 +2,56 @@
 
 #include <functional>
 
+#include <MRCPP/treebuilders/TreeBuilder.h>
+#include <MRCPP/treebuilders/WaveletAdaptor.h>
 #include <MRCPP/treebuilders/map.h>
 
+#include "PyMapCalculator.h"
+#include "core/Profiler.h"
+#include "trees/PyTreePool.h"
+
 namespace mrcpp {
 
+/** Same as mrcpp::map, but with the map applied to all values of an iteration at once */
+template <int D>
+void batch_map(double prec, FunctionTree<D, double> &out, FunctionTree<D, double> &inp, BatchMap fmap, int maxIter = -1, bool absPrec = false) {
+    int maxScale = out.getMRA().getMaxScale();
+    TreeBuilder<D, double> builder;
+    WaveletAdaptor<D, double> adaptor(prec, maxScale, absPrec);
+    PyMapCalculator<D> calculator(std::move(fmap), inp);
+
+    builder.build(out, calculator, adaptor, maxIter);
+    out.mwTransform(BottomUp);
+    out.calcSquareNorm();
+    vampyr::sample_memory(&out, &inp);
+    inp.deleteGenerated();
+}
+
 template <int D> class PyFunctionMap final {
 public:
     explicit PyFunctionMap(std::function<double(double)> fmap, double prec = -1.0)
             : precision(prec)
             , func_map(fmap) {}
+    explicit PyFunctionMap(BatchMap fmap, double prec = -1.0)
+            : precision(prec)
+            , batch_func_map(fmap) {}
 
-    std::unique_ptr<FunctionTree<D, double>> operator()(FunctionTree<D, double> &inp) {
+    PyTreePtr<D> operator()(FunctionTree<D, double> &inp) {
         // Negative precision will copy grid from input
-        auto out = std::make_unique<FunctionTree<D, double>>(inp.getMRA());
+        auto out = make_tree<D>(inp.getMRA());
         if (this->precision < 0.0) copy_grid<D, double>(*out, inp);
-        map<D>(this->precision, *out, inp, this->func_map);
+        if (this->batch_func_map) {
+            batch_map<D>(this->precision, *out, inp, this->batch_func_map);
+        } else {
+            map<D>(this->precision, *out, inp, this->func_map);
+        }
         return out;
     }
 
 private:
     double precision;
     std::function<double(double)> func_map;
+    BatchMap batch_func_map;
 };
 
 } // namespace mrcpp
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include <MRCPP/Printer>
+#include <MRCPP/functions/GaussExp.h>
+#include <MRCPP/functions/GaussFunc.h>
+#include <MRCPP/treebuilders/TreeCalculator.h>
+#include <MRCPP/trees/MWNode.h>
+
+namespace mrcpp {
+
+/*
+ * Projection calculator for large expansions of plain Gaussians, i.e.
+ * GaussFunc terms without polynomial factors.
+ *
+ * Every Gaussian is given an extent, the box outside of which its exponential
+ * factor drops below screen_thrs along some axis. The Gaussians are sorted
+ * once into a bounding volume hierarchy of their extents, clusters of nearby
+ * Gaussians with the box enclosing them. For each node only the Gaussians
+ * whose extent overlaps the quadrature points of the node are gathered, and
+ * they are summed with a loop over Gaussians that the compiler can vectorize.
+ * The error of the screening is below screen_thrs times the sum of the
+ * absolute coefficients of the Gaussians.
+ */
+template <int D> class PyGaussExpCalculator final : public TreeCalculator<D, double> {
+public:
+    static constexpr double screen_thrs = 1.0e-15;
+
+    PyGaussExpCalculator(const GaussExp<D> &gexp, const std::array<double, D> &sf)
+            : scaling_factor(sf) {
+        int nFuncs = gexp.size();
+        std::vector<double> in_coef(nFuncs);
+        std::array<std::vector<double>, D> in_exps, in_pos;
+        for (int d = 0; d < D; d++) {
+            in_exps[d].resize(nFuncs);
+            in_pos[d].resize(nFuncs);
+        }
+        for (int i = 0; i < nFuncs; i++) {
+            const auto &gauss = gexp.getFunc(i);
+            in_coef[i] = gauss.getCoef();
+            for (int d = 0; d < D; d++) {
+                in_exps[d][i] = gauss.getExp()[d];
+                in_pos[d][i] = gauss.getPos()[d];
+            }
+        }
+
+        // Sort the Gaussians into clusters, and store them in cluster order
+        std::vector<int> order(nFuncs);
+        std::iota(order.begin(), order.end(), 0);
+        if (nFuncs > 0) buildCluster(order, 0, nFuncs, in_pos, in_exps);
+        this->coef.resize(nFuncs);
+        for (int d = 0; d < D; d++) {
+            this->exps[d].resize(nFuncs);
+            this->pos[d].resize(nFuncs);
+            this->lower[d].resize(nFuncs);
+            this->upper[d].resize(nFuncs);
+        }
+        for (int i = 0; i < nFuncs; i++) {
+            int j = order[i];
+            this->coef[i] = in_coef[j];
+            for (int d = 0; d < D; d++) {
+                double r = extent(in_exps[d][j]);
+                this->exps[d][i] = in_exps[d][j];
+                this->pos[d][i] = in_pos[d][j];
+                this->lower[d][i] = in_pos[d][j] - r;
+                this->upper[d][i] = in_pos[d][j] + r;
+            }
+        }
+    }
+
+    /** @returns True if all terms are plain Gaussians, which this calculator handles */
+    static bool canScreen(const GaussExp<D> &gexp) {
+        if (gexp.size() == 0) return false;
+        for (int i = 0; i < gexp.size(); i++) {
+            const auto &gauss = gexp.getFunc(i);
+            if (dynamic_cast<const GaussFunc<D> *>(&gauss) == nullptr) return false;
+            for (int d = 0; d < D; d++) {
+                if (gauss.getPower()[d] != 0 or gauss.getExp()[d] <= 0.0) return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    static constexpr int leaf_size = 16;
+
+    // Box enclosing the extents of a range of Gaussians, with children or a leaf
+    struct Cluster {
+        std::array<double, D> lower;
+        std::array<double, D> upper;
+        int begin;
+        int end;
+        int left;
+        int right;
+    };
+
+    std::array<double, D> scaling_factor;
+    std::vector<Cluster> clusters;
+    std::vector<double> coef;
+    std::array<std::vector<double>, D> exps;
+    std::array<std::vector<double>, D> pos;
+    std::array<std::vector<double>, D> lower;
+    std::array<std::vector<double>, D> upper;
+
+    static double extent(double beta) { return std::sqrt(-std::log(screen_thrs) / beta); }
+
+    static bool overlaps(const double *lo_a, const double *hi_a, const std::array<double, D> &lo_b, const std::array<double, D> &hi_b) {
+        for (int d = 0; d < D; d++) {
+            if (hi_a[d] < lo_b[d] or lo_a[d] > hi_b[d]) return false;
+        }
+        return true;
+    }
+
+    // Splits the Gaussians in order[begin, end) at the median of the widest axis of their centers
+    int buildCluster(std::vector<int> &order,
+                     int begin,
+                     int end,
+                     const std::array<std::vector<double>, D> &in_pos,
+                     const std::array<std::vector<double>, D> &in_exps) {
+        Cluster cluster{{}, {}, begin, end, -1, -1};
+        std::array<double, D> cmin, cmax;
+        cluster.lower.fill(std::numeric_limits<double>::max());
+        cluster.upper.fill(std::numeric_limits<double>::lowest());
+        cmin = cluster.lower;
+        cmax = cluster.upper;
+        for (int i = begin; i < end; i++) {
+            int j = order[i];
+            for (int d = 0; d < D; d++) {
+                double r = extent(in_exps[d][j]);
+                cluster.lower[d] = std::min(cluster.lower[d], in_pos[d][j] - r);
+                cluster.upper[d] = std::max(cluster.upper[d], in_pos[d][j] + r);
+                cmin[d] = std::min(cmin[d], in_pos[d][j]);
+                cmax[d] = std::max(cmax[d], in_pos[d][j]);
+            }
+        }
+        int idx = this->clusters.size();
+        this->clusters.push_back(cluster);
+        if (end - begin <= leaf_size) return idx;
+
+        int axis = 0;
+        for (int d = 1; d < D; d++) {
+            if (cmax[d] - cmin[d] > cmax[axis] - cmin[axis]) axis = d;
+        }
+        int mid = begin + (end - begin) / 2;
+        const auto &x = in_pos[axis];
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end, [&x](int a, int b) { return x[a] < x[b]; });
+        int left = buildCluster(order, begin, mid, in_pos, in_exps);
+        int right = buildCluster(order, mid, end, in_pos, in_exps);
+        this->clusters[idx].left = left;
+        this->clusters[idx].right = right;
+        return idx;
+    }
+
+    // Collects the Gaussians whose extent overlaps the box [lo, hi]
+    void collect(const std::array<double, D> &lo, const std::array<double, D> &hi, std::vector<int> &out) const {
+        out.clear();
+        if (this->clusters.empty()) return;
+        std::vector<int> stack{0};
+        while (not stack.empty()) {
+            const auto &cluster = this->clusters[stack.back()];
+            stack.pop_back();
+            if (not overlaps(cluster.lower.data(), cluster.upper.data(), lo, hi)) continue;
+            if (cluster.left >= 0) {
+                stack.push_back(cluster.left);
+                stack.push_back(cluster.right);
+                continue;
+            }
+            for (int i = cluster.begin; i < cluster.end; i++) {
+                bool overlap = true;
+                for (int d = 0; d < D; d++) overlap = overlap and this->upper[d][i] >= lo[d] and this->lower[d][i] <= hi[d];
+                if (overlap) out.push_back(i);
+            }
+        }
+    }
+
+    void calcNode(MWNode<D, double> &node) override {
+        Eigen::MatrixXd exp_pts;
+        node.getExpandedChildPts(exp_pts);
+        int nCoefs = node.getNCoefs();
+
+        // The quadrature points are the only places where the Gaussians are evaluated
+        std::array<double, D> lo, hi;
+        for (int d = 0; d < D; d++) {
+            exp_pts.row(d) *= this->scaling_factor[d];
+            lo[d] = exp_pts.row(d).minCoeff();
+            hi[d] = exp_pts.row(d).maxCoeff();
+        }
+
+        std::vector<int> funcs;
+        collect(lo, hi, funcs);
+        int nFuncs = funcs.size();
+        std::vector<double> c(nFuncs);
+        std::array<std::vector<double>, D> a, x0;
+        for (int d = 0; d < D; d++) {
+            a[d].resize(nFuncs);
+            x0[d].resize(nFuncs);
+        }
+        for (int j = 0; j < nFuncs; j++) {
+            c[j] = this->coef[funcs[j]];
+            for (int d = 0; d < D; d++) {
+                a[d][j] = this->exps[d][funcs[j]];
+                x0[d][j] = this->pos[d][funcs[j]];
+            }
+        }
+
+        double *coefs = node.getCoefs();
+        for (int i = 0; i < nCoefs; i++) {
+            std::array<double, D> r;
+            for (int d = 0; d < D; d++) r[d] = exp_pts(d, i);
+            double val = 0.0;
+#pragma omp simd reduction(+ : val)
+            for (int j = 0; j < nFuncs; j++) {
+                double q = 0.0;
+                for (int d = 0; d < D; d++) {
+                    double dx = r[d] - x0[d][j];
+                    q += a[d][j] * dx * dx;
+                }
+                val += c[j] * std::exp(-q);
+            }
+            coefs[i] = val;
+        }
+        node.cvTransform(Backward);
+        node.mwTransform(Compression);
+        node.setHasCoefs();
+        node.calcNorms();
+    }
+};
+
+} // namespace mrcpp
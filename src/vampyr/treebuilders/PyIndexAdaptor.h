@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <MRCPP/treebuilders/TreeAdaptor.h>
+#include <MRCPP/trees/MWNode.h>
+
+namespace mrcpp {
+
+/*
+ * Tree adaptor reproducing a grid given as a list of node indices. A node is
+ * split whenever it is the parent of a listed node, so all listed nodes and
+ * their siblings exist after building, regardless of the order of the list.
+ */
+template <int D> class PyIndexAdaptor final : public TreeAdaptor<D, double> {
+public:
+    using Key = std::pair<int, std::array<int, D>>;
+
+    PyIndexAdaptor(int rootScale, int maxScale, const std::vector<Key> &keys)
+            : TreeAdaptor<D, double>(maxScale) {
+        for (auto key : keys) {
+            // Insert all ancestors, stop when reaching a known branch
+            while (key.first > rootScale) {
+                key.first--;
+                for (int d = 0; d < D; d++) key.second[d] = floor_div2(key.second[d]);
+                if (not this->branches.insert(key).second) break;
+            }
+        }
+    }
+
+    static Key makeKey(const NodeIndex<D> &idx) {
+        Key key{idx.getScale(), {}};
+        for (int d = 0; d < D; d++) key.second[d] = idx.getTranslation(d);
+        return key;
+    }
+
+protected:
+    std::set<Key> branches;
+
+    bool splitNode(const MWNode<D, double> &node) const override {
+        return (this->branches.count(makeKey(node.getNodeIndex())) > 0);
+    }
+
+    // Translation of the parent node, also for negative translations
+    static int floor_div2(int l) { return (l >= 0) ? l / 2 : -((-l + 1) / 2); }
+};
+
+} // namespace mrcpp
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <MRCPP/Printer>
+#include <MRCPP/treebuilders/TreeCalculator.h>
+#include <MRCPP/trees/FunctionTree.h>
+#include <MRCPP/trees/MWNode.h>
+
+namespace mrcpp {
+
+// Batched map: takes the N values of the input function and fills the N mapped values
+using BatchMap = std::function<void(const std::vector<double> &inp, std::vector<double> &out)>;
+
+/*
+ * Map calculator that applies the map once per refinement iteration instead
+ * of once per value. The input function is evaluated at the quadrature points
+ * of all nodes in the work vector in parallel, the values are passed to the
+ * batch map in a single call, and the mapped values are transformed to MW
+ * coefficients in parallel. The batch map is always invoked from the calling
+ * thread, outside of any OpenMP region.
+ */
+template <int D> class PyMapCalculator final : public TreeCalculator<D, double> {
+public:
+    PyMapCalculator(BatchMap f, FunctionTree<D, double> &inp)
+            : func(std::move(f))
+            , inp_tree(&inp) {}
+
+    void calcNodeVector(MWNodeVector<D, double> &nodeVec) override {
+        int nNodes = nodeVec.size();
+        if (nNodes == 0) return;
+        int nCoefs = nodeVec[0]->getNCoefs();
+
+        std::vector<double> inp_vals(static_cast<size_t>(nNodes) * nCoefs);
+        std::vector<double> out_vals(static_cast<size_t>(nNodes) * nCoefs);
+
+#pragma omp parallel for schedule(guided) num_threads(mrcpp_get_num_threads())
+        for (int n = 0; n < nNodes; n++) {
+            MWNode<D, double> &node_o = *nodeVec[n];
+            // This generates missing nodes
+            const MWNode<D, double> &node_i = this->inp_tree->getNode(node_o.getNodeIndex());
+            // The output node is used as scratch space for the input values
+            double *coefs = node_o.getCoefs();
+            const double *coefs_i = node_i.getCoefs();
+            for (int i = 0; i < nCoefs; i++) coefs[i] = coefs_i[i];
+            node_o.mwTransform(Reconstruction);
+            node_o.cvTransform(Forward);
+            double *v = inp_vals.data() + static_cast<size_t>(n) * nCoefs;
+            for (int i = 0; i < nCoefs; i++) v[i] = coefs[i];
+        }
+
+        this->func(inp_vals, out_vals);
+
+#pragma omp parallel for schedule(guided) num_threads(mrcpp_get_num_threads())
+        for (int n = 0; n < nNodes; n++) {
+            MWNode<D, double> &node = *nodeVec[n];
+            const double *v = out_vals.data() + static_cast<size_t>(n) * nCoefs;
+            double *coefs = node.getCoefs();
+            for (int i = 0; i < nCoefs; i++) coefs[i] = v[i];
+            node.cvTransform(Backward);
+            node.mwTransform(Compression);
+            node.setHasCoefs();
+            node.calcNorms();
+        }
+    }
+
+private:
+    BatchMap func;
+    FunctionTree<D, double> *inp_tree;
+
+    void calcNode(MWNode<D, double> &node) override { NOT_REACHED_ABORT; }
+};
+
+} // namespace mrcpp
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <MRCPP/Parallel>
+
+namespace mrcpp {
+
+enum class MapKernelType { Exp, Log, Log1p, Sqrt, Abs, Pow, Inverse, Clamp, Scale };
+
+/*
+ * Built-in map of function values, made of one or more elementary kernels
+ * applied in sequence, e.g. clamp followed by pow. It is applied to whole
+ * arrays of values, one kernel at a time, with simple loops that the compiler
+ * can vectorize, and can be used wherever a BatchMap is expected.
+ *
+ * Parameters of the kernels:
+ *   Pow:     exponent p, x^p
+ *   Inverse: cutoff c (default 0), 1/x where |x| > c and 0 elsewhere
+ *   Clamp:   lower and upper bound (default -inf and inf)
+ *   Scale:   factor a, a*x
+ */
+class PyMapKernel final {
+public:
+    PyMapKernel(MapKernelType type, const std::vector<double> &params = {}) {
+        Step step{type, 0.0, 0.0};
+        auto nParams = params.size();
+        auto check = [&](size_t min, size_t max) {
+            if (nParams < min or nParams > max) throw std::invalid_argument("Invalid number of parameters for map kernel " + name(type));
+        };
+        switch (type) {
+            case MapKernelType::Pow:
+            case MapKernelType::Scale:
+                check(1, 1);
+                step.a = params[0];
+                break;
+            case MapKernelType::Inverse:
+                check(0, 1);
+                step.a = (nParams > 0) ? params[0] : 0.0;
+                break;
+            case MapKernelType::Clamp:
+                check(0, 2);
+                step.a = (nParams > 0) ? params[0] : -std::numeric_limits<double>::infinity();
+                step.b = (nParams > 1) ? params[1] : std::numeric_limits<double>::infinity();
+                if (step.a > step.b) throw std::invalid_argument("Lower bound of clamp is above the upper bound");
+                break;
+            default:
+                check(0, 0);
+        }
+        this->steps.push_back(step);
+    }
+    PyMapKernel(const std::string &kernel, const std::vector<double> &params = {})
+            : PyMapKernel(type(kernel), params) {}
+
+    static std::string name(MapKernelType type) {
+        switch (type) {
+            case MapKernelType::Exp:
+                return "exp";
+            case MapKernelType::Log:
+                return "log";
+            case MapKernelType::Log1p:
+                return "log1p";
+            case MapKernelType::Sqrt:
+                return "sqrt";
+            case MapKernelType::Abs:
+                return "abs";
+            case MapKernelType::Pow:
+                return "pow";
+            case MapKernelType::Inverse:
+                return "inverse";
+            case MapKernelType::Clamp:
+                return "clamp";
+            case MapKernelType::Scale:
+                return "scale";
+        }
+        return "";
+    }
+
+    static MapKernelType type(std::string kernel) {
+        std::transform(kernel.begin(), kernel.end(), kernel.begin(), [](unsigned char c) { return std::tolower(c); });
+        for (auto t : {MapKernelType::Exp,
+                       MapKernelType::Log,
+                       MapKernelType::Log1p,
+                       MapKernelType::Sqrt,
+                       MapKernelType::Abs,
+                       MapKernelType::Pow,
+                       MapKernelType::Inverse,
+                       MapKernelType::Clamp,
+                       MapKernelType::Scale}) {
+            if (kernel == name(t)) return t;
+        }
+        throw std::invalid_argument("Unknown map kernel: " + kernel);
+    }
+
+    /** @returns The composed map, applying this map first and then next */
+    PyMapKernel then(const PyMapKernel &next) const {
+        PyMapKernel out(*this);
+        out.steps.insert(out.steps.end(), next.steps.begin(), next.steps.end());
+        return out;
+    }
+
+    /** Applies the map in place to n contiguous values */
+    void apply(double *x, int n) const {
+        for (const auto &step : this->steps) {
+            const double a = step.a;
+            const double b = step.b;
+            switch (step.type) {
+                case MapKernelType::Exp:
+#pragma omp simd
+                    for (int i = 0; i < n; i++) x[i] = std::exp(x[i]);
+                    break;
+                case MapKernelType::Log:
+#pragma omp simd
+                    for (int i = 0; i < n; i++) x[i] = std::log(x[i]);
+                    break;
+                case MapKernelType::Log1p:
+#pragma omp simd
+                    for (int i = 0; i < n; i++) x[i] = std::log1p(x[i]);
+                    break;
+                case MapKernelType::Sqrt:
+#pragma omp simd
+                    for (int i = 0; i < n; i++) x[i] = std::sqrt(x[i]);
+                    break;
+                case MapKernelType::Abs:
+#pragma omp simd
+                    for (int i = 0; i < n; i++) x[i] = std::abs(x[i]);
+                    break;
+                case MapKernelType::Pow:
+                    applyPow(x, n, a);
+                    break;
+                case MapKernelType::Inverse:
+#pragma omp simd
+                    for (int i = 0; i < n; i++) x[i] = (std::abs(x[i]) > a) ? 1.0 / x[i] : 0.0;
+                    break;
+                case MapKernelType::Clamp:
+#pragma omp simd
+                    for (int i = 0; i < n; i++) x[i] = std::min(std::max(x[i], a), b);
+                    break;
+                case MapKernelType::Scale:
+#pragma omp simd
+                    for (int i = 0; i < n; i++) x[i] *= a;
+                    break;
+            }
+        }
+    }
+
+    /** Batch map interface, values are processed in parallel blocks */
+    void operator()(const std::vector<double> &inp, std::vector<double> &out) const {
+        const int n = inp.size();
+        const int nBlocks = (n + block_size - 1) / block_size;
+        std::copy(inp.begin(), inp.end(), out.begin());
+#pragma omp parallel for schedule(static) num_threads(mrcpp_get_num_threads())
+        for (int i = 0; i < nBlocks; i++) {
+            int start = i * block_size;
+            apply(out.data() + start, std::min(block_size, n - start));
+        }
+    }
+
+    double operator()(double x) const {
+        apply(&x, 1);
+        return x;
+    }
+
+    std::string str() const {
+        std::ostringstream os;
+        for (size_t i = 0; i < this->steps.size(); i++) {
+            const auto &step = this->steps[i];
+            if (i > 0) os << " >> ";
+            os << name(step.type);
+            if (step.type == MapKernelType::Pow or step.type == MapKernelType::Scale or step.type == MapKernelType::Inverse) {
+                os << "(" << step.a << ")";
+            } else if (step.type == MapKernelType::Clamp) {
+                os << "(" << step.a << ", " << step.b << ")";
+            }
+        }
+        return os.str();
+    }
+
+private:
+    static constexpr int block_size = 4096;
+
+    struct Step {
+        MapKernelType type;
+        double a;
+        double b;
+    };
+    std::vector<Step> steps;
+
+    // Common exponents avoid the general pow
+    static void applyPow(double *x, int n, double p) {
+        if (p == 2.0) {
+#pragma omp simd
+            for (int i = 0; i < n; i++) x[i] = x[i] * x[i];
+        } else if (p == 0.5) {
+#pragma omp simd
+            for (int i = 0; i < n; i++) x[i] = std::sqrt(x[i]);
+        } else if (p == -1.0) {
+#pragma omp simd
+            for (int i = 0; i < n; i++) x[i] = 1.0 / x[i];
+        } else {
+#pragma omp simd
+            for (int i = 0; i < n; i++) x[i] = std::pow(x[i], p);
+        }
+    }
+};
+
+} // namespace mrcpp
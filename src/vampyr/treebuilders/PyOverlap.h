@@ -0,0 +1,95 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <MRCPP/trees/FunctionTree.h>
+
+#include "trees/PyTreeArrays.h"
+
+namespace mrcpp {
+
+/*
+ * Matrix of inner products <bra_i|ket_j> of two lists of trees.
+ *
+ * In the compressed MW representation the inner product of two trees is
+ * the product of their root scaling coefficients plus the products of the
+ * wavelet coefficients of all nodes present in both trees. The nodes of all
+ * trees are therefore grouped by node index, and each node contributes a
+ * small GEMM between the coefficients of the bras and the kets having it.
+ * Node groups are processed in parallel with thread-local accumulators.
+ * When bras and kets are the same list, only the lower triangle is computed.
+ */
+template <int D> Eigen::MatrixXd overlap_matrix(const std::vector<FunctionTree<D, double> *> &bras, const std::vector<FunctionTree<D, double> *> &kets) {
+    using Key = typename PyIndexAdaptor<D>::Key;
+    bool symmetric = (bras == kets);
+    int nBras = bras.size();
+    int nKets = kets.size();
+    Eigen::MatrixXd S = Eigen::MatrixXd::Zero(nBras, nKets);
+    if (nBras == 0 or nKets == 0) return S;
+
+    // Node groups: the bra and ket nodes sharing a node index
+    struct Group {
+        std::vector<std::pair<int, const MWNode<D, double> *>> bras, kets;
+    };
+    std::map<Key, Group> groups;
+    auto collect = [&groups](const std::vector<FunctionTree<D, double> *> &trees, bool bra) {
+        for (int i = 0; i < trees.size(); i++) {
+            for (auto *node : tree_nodes<D>(*trees[i])) {
+                if (not node->hasCoefs()) continue;
+                auto &group = groups[PyIndexAdaptor<D>::makeKey(node->getNodeIndex())];
+                (bra ? group.bras : group.kets).push_back({i, node});
+            }
+        }
+    };
+    collect(bras, true);
+    if (not symmetric) collect(kets, false);
+
+    std::vector<const Group *> work;
+    work.reserve(groups.size());
+    for (const auto &g : groups) work.push_back(&g.second);
+
+    int nGroups = work.size();
+#pragma omp parallel num_threads(mrcpp_get_num_threads())
+    {
+        Eigen::MatrixXd S_loc = Eigen::MatrixXd::Zero(nBras, nKets);
+        Eigen::MatrixXd B, K, BK;
+#pragma omp for schedule(dynamic)
+        for (int n = 0; n < nGroups; n++) {
+            const auto &g = *work[n];
+            const auto &ketNodes = symmetric ? g.bras : g.kets;
+            if (g.bras.empty() or ketNodes.empty()) continue;
+
+            // Root nodes contribute both scaling and wavelet parts
+            const auto *first = g.bras[0].second;
+            int nCoefs = first->getNCoefs();
+            int offset = first->isRootNode() ? 0 : first->getKp1_d();
+            int nRows = nCoefs - offset;
+
+            B.resize(nRows, g.bras.size());
+            for (int i = 0; i < g.bras.size(); i++) B.col(i) = Eigen::Map<const Eigen::VectorXd>(g.bras[i].second->getCoefs() + offset, nRows);
+            if (symmetric) {
+                BK.noalias() = B.transpose() * B;
+            } else {
+                K.resize(nRows, ketNodes.size());
+                for (int j = 0; j < ketNodes.size(); j++) K.col(j) = Eigen::Map<const Eigen::VectorXd>(ketNodes[j].second->getCoefs() + offset, nRows);
+                BK.noalias() = B.transpose() * K;
+            }
+            for (int i = 0; i < g.bras.size(); i++) {
+                for (int j = 0; j < ketNodes.size(); j++) {
+                    if (symmetric and ketNodes[j].first > g.bras[i].first) continue;
+                    S_loc(g.bras[i].first, ketNodes[j].first) += BK(i, j);
+                }
+            }
+        }
+#pragma omp critical
+        S += S_loc;
+    }
+
+    if (symmetric) S.template triangularView<Eigen::StrictlyUpper>() = S.transpose().eval();
+    return S;
+}
+
+} // namespace mrcpp
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <MRCPP/Printer>
+#include <MRCPP/treebuilders/TreeCalculator.h>
+#include <MRCPP/trees/MWNode.h>
+
+namespace mrcpp {
+
+// Batched function evaluation: takes N points as a flat row-major (N, D) array and fills N values
+using BatchFunction = std::function<void(const std::vector<double> &pts, std::vector<double> &vals)>;
+
+/*
+ * Projection calculator that evaluates the function once per refinement
+ * iteration instead of once per quadrature point. The quadrature points of
+ * all nodes in the work vector are collected in parallel, passed to the
+ * batch function in a single call, and the resulting values are transformed
+ * to MW coefficients in parallel. The batch function is always invoked from
+ * the calling thread, outside of any OpenMP region.
+ */
+template <int D> class PyProjectionCalculator final : public TreeCalculator<D, double> {
+public:
+    PyProjectionCalculator(BatchFunction f, const std::array<double, D> &sf)
+            : func(std::move(f))
+            , scaling_factor(sf) {}
+
+    void calcNodeVector(MWNodeVector<D, double> &nodeVec) override {
+        int nNodes = nodeVec.size();
+        if (nNodes == 0) return;
+        int nCoefs = nodeVec[0]->getNCoefs();
+
+        std::vector<double> pts(static_cast<size_t>(nNodes) * nCoefs * D);
+        std::vector<double> vals(static_cast<size_t>(nNodes) * nCoefs);
+
+#pragma omp parallel for schedule(guided) num_threads(mrcpp_get_num_threads())
+        for (int n = 0; n < nNodes; n++) {
+            Eigen::MatrixXd exp_pts;
+            nodeVec[n]->getExpandedChildPts(exp_pts);
+            double *r = pts.data() + static_cast<size_t>(n) * nCoefs * D;
+            for (int i = 0; i < nCoefs; i++) {
+                for (int d = 0; d < D; d++) r[i * D + d] = this->scaling_factor[d] * exp_pts(d, i);
+            }
+        }
+
+        this->func(pts, vals);
+
+#pragma omp parallel for schedule(guided) num_threads(mrcpp_get_num_threads())
+        for (int n = 0; n < nNodes; n++) {
+            MWNode<D, double> &node = *nodeVec[n];
+            const double *v = vals.data() + static_cast<size_t>(n) * nCoefs;
+            double *coefs = node.getCoefs();
+            for (int i = 0; i < nCoefs; i++) coefs[i] = v[i];
+            node.cvTransform(Backward);
+            node.mwTransform(Compression);
+            node.setHasCoefs();
+            node.calcNorms();
+        }
+    }
+
+private:
+    BatchFunction func;
+    std::array<double, D> scaling_factor;
+
+    void calcNode(MWNode<D, double> &node) override { NOT_REACHED_ABORT; }
+};
+
+} // namespace mrcpp
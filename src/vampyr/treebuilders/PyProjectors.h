@@ -1,10 +1,162 @@
 #pragma once
 
+#include <algorithm>
+#include <memory>
+
 #include <MRCPP/Printer>
+#include <MRCPP/functions/AnalyticFunction.h>
+#include <MRCPP/treebuilders/ProjectionCalculator.h>
+#include <MRCPP/treebuilders/TreeBuilder.h>
+#include <MRCPP/treebuilders/WaveletAdaptor.h>
+#include <MRCPP/treebuilders/grid.h>
 #include <MRCPP/treebuilders/project.h>
 
+#include "PyGaussExpCalculator.h"
+#include "PyProjectionCalculator.h"
+#include "functions/PyBatchEvaluator.h"
+#include "trees/PyTreePool.h"
+
 namespace mrcpp {
 
+/** Same as mrcpp::project, but with the node coefficients computed by the given calculator */
+template <int D>
+void calc_project(double prec, FunctionTree<D, double> &out, TreeCalculator<D, double> &calculator, int maxIter = -1, bool absPrec = false) {
+    int maxScale = out.getMRA().getMaxScale();
+    TreeBuilder<D, double> builder;
+    WaveletAdaptor<D, double> adaptor(prec, maxScale, absPrec);
+
+    builder.build(out, calculator, adaptor, maxIter);
+    out.mwTransform(BottomUp);
+    out.calcSquareNorm();
+}
+
+/** Same as mrcpp::project, but with the function evaluated in batches of points */
+template <int D>
+void batch_project(double prec, FunctionTree<D, double> &out, BatchFunction func, int maxIter = -1, bool absPrec = false) {
+    PyProjectionCalculator<D> calculator(std::move(func), out.getMRA().getWorldBox().getScalingFactors());
+    calc_project<D>(prec, out, calculator, maxIter, absPrec);
+}
+
+/** @returns A batch evaluation of the function, or an empty function if it has none */
+template <int D> BatchFunction batch_function(const RepresentableFunction<D, double> &func) {
+    auto *batch = dynamic_cast<const PyBatchEvaluator<D> *>(&func);
+    if (batch != nullptr and batch->hasBatch()) {
+        return [batch](const std::vector<double> &pts, std::vector<double> &vals) { batch->evalf_batch(pts, vals); };
+    }
+    return nullptr;
+}
+
+/*
+ * @returns A calculator that is faster than calling evalf() once per point,
+ * or nullptr if there is none: node screening for expansions of plain
+ * Gaussians, or batch evaluation.
+ */
+template <int D>
+std::unique_ptr<TreeCalculator<D, double>> fast_calculator(const RepresentableFunction<D, double> &func, const std::array<double, D> &sf) {
+    auto *gexp = dynamic_cast<const GaussExp<D> *>(&func);
+    if (gexp != nullptr and PyGaussExpCalculator<D>::canScreen(*gexp)) return std::make_unique<PyGaussExpCalculator<D>>(*gexp, sf);
+    if (auto batch = batch_function<D>(func)) return std::make_unique<PyProjectionCalculator<D>>(std::move(batch), sf);
+    return nullptr;
+}
+
+/** Same as mrcpp::project, but using a fast calculator for the function if there is one */
+template <int D>
+void project_function(double prec, FunctionTree<D, double> &out, RepresentableFunction<D, double> &func, int maxIter = -1, bool absPrec = false) {
+    if (auto fast = fast_calculator<D>(func, out.getMRA().getWorldBox().getScalingFactors())) {
+        calc_project<D>(prec, out, *fast, maxIter, absPrec);
+    } else {
+        project<D, double>(prec, out, func, maxIter, absPrec);
+    }
+}
+
+/*
+ * Projection on the uniform grid at the given scale, keeping only the scaling
+ * or only the wavelet part of the end nodes. The ancestors of the end nodes
+ * are then built by a single bottom-up transform.
+ *
+ * The scaling part of an end node only needs the function at the node's own
+ * quadrature points, which are the child points of its parent. The calculator
+ * is therefore run on the parents, and their children's scaling coefficients
+ * are recovered by reconstruction, so each end node costs (k+1)^D function
+ * values. At the root scale there are no parents, and the root nodes are
+ * computed from their child points like the wavelet part, which needs the
+ * function at the finer scale.
+ */
+template <int D>
+void uniform_project(FunctionTree<D, double> &out, TreeCalculator<D, double> &calculator, int scale, bool scaling) {
+    build_grid<D, double>(out, scale - out.getRootScale());
+
+    int nNodes = out.getNEndNodes();
+    MWNodeVector<D, double> nodeVec;
+    nodeVec.reserve(nNodes);
+    for (int n = 0; n < nNodes; n++) nodeVec.push_back(&out.getEndMWNode(n));
+
+    int kp1_d = out.getKp1_d();
+    int nCoefs = out.getTDim() * kp1_d;
+    if (scaling and scale > out.getRootScale()) {
+        // The grid is uniform, so every parent has all its children among the end nodes
+        MWNodeVector<D, double> parentVec;
+        parentVec.reserve(nNodes / out.getTDim());
+        for (auto *node : nodeVec) {
+            auto *parent = &node->getMWParent();
+            if (&parent->getMWChild(0) == node) parentVec.push_back(parent);
+        }
+        calculator.calcNodeVector(parentVec);
+
+        int nParents = parentVec.size();
+#pragma omp parallel for schedule(static) num_threads(mrcpp_get_num_threads())
+        for (int p = 0; p < nParents; p++) {
+            auto &parent = *parentVec[p];
+            parent.mwTransform(Reconstruction);
+            const double *pcoefs = parent.getCoefs();
+            for (int c = 0; c < parent.getTDim(); c++) {
+                auto &child = parent.getMWChild(c);
+                double *coefs = child.getCoefs();
+                std::copy(pcoefs + c * kp1_d, pcoefs + (c + 1) * kp1_d, coefs);
+                std::fill(coefs + kp1_d, coefs + nCoefs, 0.0);
+                child.setHasCoefs();
+                child.calcNorms();
+            }
+        }
+    } else {
+        calculator.calcNodeVector(nodeVec);
+#pragma omp parallel for schedule(static) num_threads(mrcpp_get_num_threads())
+        for (int n = 0; n < nNodes; n++) {
+            double *coefs = nodeVec[n]->getCoefs();
+            if (scaling) {
+                std::fill(coefs + kp1_d, coefs + nCoefs, 0.0);
+            } else {
+                std::fill(coefs, coefs + kp1_d, 0.0);
+            }
+            nodeVec[n]->calcNorms();
+        }
+    }
+
+    // Propagate result to root scale
+    out.mwTransform(BottomUp);
+    out.calcSquareNorm();
+}
+
+template <int D> void uniform_project(FunctionTree<D, double> &out, BatchFunction func, int scale, bool scaling) {
+    PyProjectionCalculator<D> calculator(std::move(func), out.getMRA().getWorldBox().getScalingFactors());
+    uniform_project<D>(out, calculator, scale, scaling);
+}
+
+template <int D> void uniform_project(FunctionTree<D, double> &out, RepresentableFunction<D, double> &func, int scale, bool scaling) {
+    if (auto fast = fast_calculator<D>(func, out.getMRA().getWorldBox().getScalingFactors())) {
+        uniform_project<D>(out, *fast, scale, scaling);
+        return;
+    }
+    ProjectionCalculator<D, double> calculator(func, out.getMRA().getWorldBox().getScalingFactors());
+    uniform_project<D>(out, calculator, scale, scaling);
+}
+
+template <int D>
+void uniform_project(FunctionTree<D, double> &out, std::function<double(const Coord<D> &r)> func, int scale, bool scaling) {
+    AnalyticFunction<D, double> inp(func);
+    uniform_project<D>(out, inp, scale, scaling);
+}
+
 template <int D> class PyScalingProjector final {
 public:
     PyScalingProjector(const MultiResolutionAnalysis<D> &mra, double prec)
@@ -18,49 +170,39 @@ public:
         if (this->min_scale < this->MRA.getRootScale()) MSG_ERROR("Invalid scale");
     }
 
-    std::unique_ptr<FunctionTree<D, double>> operator()(RepresentableFunction<D, double> &func) {
-        auto out = std::make_unique<FunctionTree<D, double>>(this->MRA);
+    PyTreePtr<D> operator()(RepresentableFunction<D, double> &func) {
+        auto out = make_tree<D>(this->MRA);
         if (this->precision > 0.0) {
             // With the adaptive projection we want s+w repr at finest scale
             build_grid<D, double>(*out, func);
-            project<D, double>(this->precision, *out, func);
+            project_function<D>(this->precision, *out, func);
         } else {
             // With the fixed scale projection we want pure s repr at finest scale
-            int depth = this->min_scale - this->MRA.getRootScale();
-            build_grid<D, double>(*out, depth);
-            project<D, double>(-1.0, *out, func);
-
-            // Need to explicitly clear w coefs after projection to get only s coefs
-            for (int n = 0; n < out->getNEndNodes(); n++) {
-                int two_d = out->getTDim();
-                int kp1_d = out->getKp1_d();
-                for (int i = 1; i < two_d; i++) { out->getEndMWNode(n).zeroCoefBlock(i, kp1_d); }
-            }
-            // Propagate result to root scale
-            out->mwTransform(BottomUp);
+            uniform_project<D>(*out, func, this->min_scale, true);
         }
         return out;
     }
 
-    std::unique_ptr<FunctionTree<D, double>> operator()(std::function<double(const Coord<D> &r)> func) {
-        auto out = std::make_unique<FunctionTree<D, double>>(this->MRA);
+    PyTreePtr<D> operator()(std::function<double(const Coord<D> &r)> func) {
+        auto out = make_tree<D>(this->MRA);
         if (this->precision > 0.0) {
             // With the adaptive projection we want s+w repr at finest scale
             project<D>(this->precision, *out, func);
         } else {
             // With the fixed scale projection we want pure s repr at finest scale
-            int depth = this->min_scale - this->MRA.getRootScale();
-            build_grid<D, double>(*out, depth);
-            project<D>(-1.0, *out, func);
-
-            // Need to explicitly clear w coefs after projection to get only s coefs
-            for (int n = 0; n < out->getNEndNodes(); n++) {
-                int two_d = out->getTDim();
-                int kp1_d = out->getKp1_d();
-                for (int i = 1; i < two_d; i++) { out->getEndMWNode(n).zeroCoefBlock(i, kp1_d); }
-            }
-            // Propagate result to root scale
-            out->mwTransform(BottomUp);
+            uniform_project<D>(*out, func, this->min_scale, true);
+        }
+        return out;
+    }
+
+    PyTreePtr<D> operator()(BatchFunction func) {
+        auto out = make_tree<D>(this->MRA);
+        if (this->precision > 0.0) {
+            // With the adaptive projection we want s+w repr at finest scale
+            batch_project<D>(this->precision, *out, std::move(func));
+        } else {
+            // With the fixed scale projection we want pure s repr at finest scale
+            uniform_project<D>(*out, std::move(func), this->min_scale, true);
         }
         return out;
     }
@@ -79,43 +221,30 @@ public:
         if (this->min_scale < this->MRA.getRootScale()) MSG_ERROR("Invalid scale");
     }
 
-    std::unique_ptr<FunctionTree<D, double>> operator()(RepresentableFunction<D, double> &func) {
+    PyTreePtr<D> operator()(RepresentableFunction<D, double> &func) {
         // With the fixed scale projection we want pure w repr at finest scale
-        auto out = std::make_unique<FunctionTree<D, double>>(this->MRA);
+        auto out = make_tree<D>(this->MRA);
 
         // Project uniformly at scale n
-        int depth = this->min_scale - this->MRA.getRootScale();
-        build_grid<D, double>(*out, depth);
-        project<D, double>(-1.0, *out, func);
-
-        // Need to explicitly clear s coefs after projection to get only w coefs
-        for (int n = 0; n < out->getNEndNodes(); n++) {
-            int kp1_d = out->getKp1_d();
-            out->getEndMWNode(n).zeroCoefBlock(0, kp1_d);
-        }
-
-        // Propagate result to root scale
-        out->mwTransform(BottomUp);
+        uniform_project<D>(*out, func, this->min_scale, false);
         return out;
     }
 
-    std::unique_ptr<FunctionTree<D, double>> operator()(std::function<double(const Coord<D> &r)> func) {
+    PyTreePtr<D> operator()(std::function<double(const Coord<D> &r)> func) {
         // With the fixed scale projection we want pure w repr at finest scale
-        auto out = std::make_unique<FunctionTree<D, double>>(this->MRA);
+        auto out = make_tree<D>(this->MRA);
 
         // Project uniformly at scale n
-        int depth = this->min_scale - this->MRA.getRootScale();
-        build_grid<D, double>(*out, depth);
-        project<D>(-1.0, *out, func);
-
-        // Need to explicitly clear s coefs after projection to get only w coefs
-        for (int n = 0; n < out->getNEndNodes(); n++) {
-            int kp1_d = out->getKp1_d();
-            out->getEndMWNode(n).zeroCoefBlock(0, kp1_d);
-        }
+        uniform_project<D>(*out, func, this->min_scale, false);
+        return out;
+    }
+
+    PyTreePtr<D> operator()(BatchFunction func) {
+        // With the fixed scale projection we want pure w repr at finest scale
+        auto out = make_tree<D>(this->MRA);
 
-        // Propagate result to root scale
-        out->mwTransform(BottomUp);
+        // Project uniformly at scale n
+        uniform_project<D>(*out, std::move(func), this->min_scale, false);
         return out;
     }
 
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <MRCPP/treebuilders/grid.h>
+#include <MRCPP/trees/FunctionTree.h>
+
+#include "core/Profiler.h"
+#include "trees/PyTreePool.h"
+
+namespace mrcpp {
+
+/*
+ * Linear transformation of a set of trees, out_j = sum_i U_ij inp_i.
+ *
+ * The union grid of the inputs is built once and copied to all outputs.
+ * Since the transformation is linear, it can be applied directly to the MW
+ * coefficients: for every end node of the union grid, the coefficients of
+ * all inputs are collected in a matrix F (nCoefs x nInp), and one GEMM F * U
+ * gives the coefficients of all outputs. End nodes are processed in parallel,
+ * and the branch nodes are computed by a bottom-up transform at the end.
+ */
+template <int D>
+std::vector<PyTreePtr<D>> rotate(const std::vector<FunctionTree<D, double> *> &inp, const Eigen::MatrixXd &U) {
+    int nInp = inp.size();
+    int nOut = U.cols();
+    std::vector<PyTreePtr<D>> out;
+    if (nInp == 0 or nOut == 0) return out;
+
+    const auto &mra = inp[0]->getMRA();
+    FunctionTreeVector<D, double> vec;
+    for (auto *tree : inp) vec.push_back({1.0, tree});
+    for (int j = 0; j < nOut; j++) out.push_back(make_tree<D>(mra));
+    build_grid(*out[0], vec);
+    for (int j = 1; j < nOut; j++) copy_grid(*out[j], *out[0]);
+
+    int nEndNodes = out[0]->getNEndNodes();
+    std::vector<NodeIndex<D>> indices;
+    indices.reserve(nEndNodes);
+    for (int n = 0; n < nEndNodes; n++) indices.push_back(out[0]->getEndMWNode(n).getNodeIndex());
+
+#pragma omp parallel num_threads(mrcpp_get_num_threads())
+    {
+        Eigen::MatrixXd F, G;
+#pragma omp for schedule(guided)
+        for (int n = 0; n < nEndNodes; n++) {
+            const NodeIndex<D> &idx = indices[n];
+            for (int i = 0; i < nInp; i++) {
+                // This generates missing nodes
+                const MWNode<D, double> &node_i = inp[i]->getNode(idx);
+                if (i == 0) F.resize(node_i.getNCoefs(), nInp);
+                F.col(i) = Eigen::Map<const Eigen::VectorXd>(node_i.getCoefs(), node_i.getNCoefs());
+            }
+            G.noalias() = F * U;
+            for (int j = 0; j < nOut; j++) {
+                MWNode<D, double> &node_j = out[j]->getNode(idx);
+                Eigen::Map<Eigen::VectorXd>(node_j.getCoefs(), node_j.getNCoefs()) = G.col(j);
+                node_j.setHasCoefs();
+                node_j.calcNorms();
+            }
+        }
+    }
+
+    for (auto &tree : out) {
+        tree->mwTransform(BottomUp);
+        tree->calcSquareNorm();
+    }
+    vampyr::sample_memory(out, inp);
+    for (auto *tree : inp) tree->deleteGenerated();
+    return out;
+}
+
+} // namespace mrcpp
@@ -5,6 +5,11 @@
 
 #include <MRCPP/treebuilders/apply.h>
 
+#include "PyApply.h"
+#include "core/Profiler.h"
+#include "trees/PyTreePool.h"
+#include "trees/TreeLock.h"
+
 namespace vampyr {
 template <int D> void applys(pybind11::module &m) {
     using namespace mrcpp;
@@ -14,30 +19,38 @@ template <int D> void applys(pybind11::module &m) {
     m.def(
         "divergence",
         [](DerivativeOperator<D> &oper, std::vector<FunctionTree<D, double> *> &inp) {
-            std::unique_ptr<FunctionTree<D, double>> out{nullptr};
+            TreeLock lock(&oper, inp);
+            ProfileScope prof("divergence", inp);
+            PyTreePtr<D> out{nullptr};
             if (inp.size() == (size_t)D) {
-                out = std::make_unique<FunctionTree<D, double>>(inp[0]->getMRA());
+                out = make_tree<D>(inp[0]->getMRA());
+                prof.output(out);
                 divergence<D, double>(*out, oper, inp);
             }
             return out;
         },
         "oper"_a,
-        "inp"_a);
+        "inp"_a,
+        py::call_guard<py::gil_scoped_release>());
 
     m.def(
         "gradient",
         [](DerivativeOperator<D> &oper, FunctionTree<D, double> &inp) {
+            TreeLock lock(&oper, &inp);
+            ProfileScope prof("gradient", &inp);
             auto tmp = mrcpp::gradient<D, double>(oper, inp);
-            std::vector<std::unique_ptr<FunctionTree<D, double>>> out;
+            std::vector<PyTreePtr<D>> out;
             for (size_t i = 0; i < tmp.size(); i++) {
                 auto *tmp_p = std::get<1>(tmp[i]);
-                out.push_back(std::unique_ptr<FunctionTree<D, double>>(tmp_p));
+                out.push_back(adopt_tree<D>(tmp_p));
             }
             mrcpp::clear(tmp, false);
+            prof.output(out);
             return out;
         },
         "oper"_a,
-        "inp"_a);
+        "inp"_a,
+        py::call_guard<py::gil_scoped_release>());
 }
 
 // Direct bindings to MRCPP functionality
@@ -49,23 +62,31 @@ template <int D> void advanced_applys(pybind11::module &m) {
     m.def(
         "apply",
         [](double prec, FunctionTree<D, double> &out, ConvolutionOperator<D> &oper, FunctionTree<D, double> &inp, int max_iter, bool abs_prec) {
-            mrcpp::apply<D, double>(prec, out, oper, inp, max_iter, abs_prec);
+            TreeLock lock(&out, &oper, &inp);
+            ProfileScope prof("advanced.apply", &inp);
+            prof.output(&out);
+            mrcpp::apply_tree<D>(prec, out, oper, inp, max_iter, abs_prec);
         },
         "prec"_a,
         "out"_a,
         "oper"_a,
         "inp"_a,
         "max_iter"_a = -1,
-        "abs_prec"_a = false);
+        "abs_prec"_a = false,
+        py::call_guard<py::gil_scoped_release>());
 
     m.def("apply",
           [](FunctionTree<D, double> &out, DerivativeOperator<D> &oper, FunctionTree<D, double> &inp, int dir) {
+              TreeLock lock(&out, &oper, &inp);
+              ProfileScope prof("advanced.apply", &inp);
+              prof.output(&out);
               mrcpp::apply<D, double>(out, oper, inp, dir);
           },
           "out"_a,
           "oper"_a,
           "inp"_a,
-          "dir"_a = -1);
+          "dir"_a = -1,
+          py::call_guard<py::gil_scoped_release>());
 }
 
 } // namespace vampyr
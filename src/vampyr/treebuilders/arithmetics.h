@@ -1,8 +1,19 @@
 #pragma once
 
+#include <optional>
+
+#include <pybind11/eigen.h>
+#include <pybind11/stl.h>
+
 #include <MRCPP/treebuilders/add.h>
 #include <MRCPP/treebuilders/multiply.h>
 
+#include "PyOverlap.h"
+#include "PyRotate.h"
+#include "core/Profiler.h"
+#include "trees/PyTreePool.h"
+#include "trees/TreeLock.h"
+
 namespace vampyr {
 template <int D> void arithmetics(pybind11::module &m) {
     using namespace mrcpp;
@@ -12,10 +23,13 @@ template <int D> void arithmetics(pybind11::module &m) {
     m.def(
         "sum",
         [](std::vector<FunctionTree<D, double> *> &inp) {
-            auto out = std::unique_ptr<FunctionTree<D, double>>(nullptr);
+            TreeLock lock(inp);
+            ProfileScope prof("sum", inp);
+            auto out = PyTreePtr<D>(nullptr);
             if (inp.size() > 0) {
                 auto &mra = inp[0]->getMRA();
-                out = std::make_unique<FunctionTree<D, double>>(mra);
+                out = make_tree<D>(mra);
+                prof.output(out);
                 FunctionTreeVector<D, double> vec;
                 for (auto* tree : inp) vec.push_back({1.0, tree});
                 build_grid(*out, vec);
@@ -23,15 +37,19 @@ template <int D> void arithmetics(pybind11::module &m) {
             }
             return out;
         },
-        "inp"_a);
+        "inp"_a,
+        py::call_guard<py::gil_scoped_release>());
 
     m.def(
         "sum",
         [](std::vector<std::tuple<double, FunctionTree<D, double> *>> &inp) {
-            auto out = std::unique_ptr<FunctionTree<D, double>>(nullptr);
+            TreeLock lock(inp);
+            ProfileScope prof("sum", inp);
+            auto out = PyTreePtr<D>(nullptr);
             if (inp.size() > 0) {
                 auto &mra = std::get<1>(inp[0])->getMRA();
-                out = std::make_unique<FunctionTree<D, double>>(mra);
+                out = make_tree<D>(mra);
+                prof.output(out);
                 FunctionTreeVector<D, double> vec;
                 for (auto& t : inp) vec.push_back({std::get<0>(t), std::get<1>(t)});
                 build_grid(*out, vec);
@@ -39,42 +57,115 @@ template <int D> void arithmetics(pybind11::module &m) {
             }
             return out;
         },
-        "inp"_a);
+        "inp"_a,
+        py::call_guard<py::gil_scoped_release>());
 
-    m.def("dot", [](FunctionTree<D, double> &bra, FunctionTree<D, double> &ket) { return mrcpp::dot<D, double>(bra, ket); }, "bra"_a, "ket"_a);
+    m.def(
+        "dot",
+        [](FunctionTree<D, double> &bra, FunctionTree<D, double> &ket) {
+            TreeLock lock(&bra, &ket);
+            ProfileScope prof("dot", &bra, &ket);
+            return mrcpp::dot<D, double>(bra, ket);
+        },
+        "bra"_a,
+        "ket"_a,
+        py::call_guard<py::gil_scoped_release>());
 
     m.def(
         "dot",
         [](std::vector<FunctionTree<D, double> *> &inp_a, std::vector<FunctionTree<D, double> *> &inp_b) {
-            auto out = std::unique_ptr<FunctionTree<D, double>>(nullptr);
+            TreeLock lock(inp_a, inp_b);
+            ProfileScope prof("dot", inp_a, inp_b);
+            auto out = PyTreePtr<D>(nullptr);
             if ((inp_a.size() > 0) && (inp_b.size() == inp_a.size())) {
                 auto &mra = inp_a[0]->getMRA();
-                out = std::make_unique<FunctionTree<D, double>>(mra);
-                auto out_vec = FunctionTreeVector<D, double>();
+                out = make_tree<D>(mra);
+                prof.output(out);
+                out->setZero();
+                // Accumulate pair by pair, only one product tree is alive at a time.
+                // Each multiply and add is parallel over nodes, while running pairs
+                // concurrently would need one product tree per thread.
                 for (size_t i = 0; i < inp_a.size(); ++i) {
-                    auto *prod = new FunctionTree<D, double>(mra);
-                    build_grid(*prod, *inp_a[i]);
-                    build_grid(*prod, *inp_b[i]);
-                    build_grid(*prod, 1);
-                    multiply(-1.0, *prod, 1.0, *inp_a[i], *inp_b[i]);
-                    out_vec.push_back({1.0, prod});
+                    FunctionTree<D, double> prod(mra);
+                    build_grid(prod, *inp_a[i]);
+                    build_grid(prod, *inp_b[i]);
+                    build_grid(prod, 1);
+                    multiply(-1.0, prod, 1.0, *inp_a[i], *inp_b[i]);
+                    // refine_grid adds one level per call
+                    while (refine_grid(*out, prod) > 0) {}
+                    out->add(1.0, prod);
+                    prof.sample(out, &prod, inp_a[i], inp_b[i]);
                 }
-                build_grid(*out, out_vec); // Union grid
-                add(-1.0, *out, out_vec);
-                clear(out_vec, true);
             }
             return out;
         },
         "inp_a"_a,
-        "inp_b"_a);
+        "inp_b"_a,
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def(
+        "overlap_matrix",
+        [](std::vector<FunctionTree<D, double> *> bras, std::optional<std::vector<FunctionTree<D, double> *>> kets, py::object oper) {
+            if (not kets) kets = bras;
+            // Operator results are kept alive by the list until the matrix is computed
+            py::list applied;
+            if (not oper.is_none()) {
+                if (py::hasattr(oper, "apply_many")) {
+                    applied = py::list(oper.attr("apply_many")(*kets));
+                } else {
+                    for (auto *ket : *kets) applied.append(oper(ket));
+                }
+                kets = applied.cast<std::vector<FunctionTree<D, double> *>>();
+            }
+            py::gil_scoped_release release;
+            TreeLock lock(bras, *kets);
+            ProfileScope prof("overlap_matrix", bras, *kets);
+            return mrcpp::overlap_matrix<D>(bras, *kets);
+        },
+        "bras"_a,
+        "kets"_a = py::none(),
+        "oper"_a = py::none(),
+        R"mydelimiter(
+        Matrix of inner products S_ij = <bra_i|ket_j>, as a NumPy array.
+
+        With kets omitted, the symmetric overlap matrix of the bras is computed.
+        With an operator given, the matrix elements <bra_i|O|ket_j> are computed,
+        where O is applied to all kets at once if it supports apply_many. All
+        elements are computed in a single parallel pass over the nodes of the
+        trees, which is much faster than separate calls to dot.
+        )mydelimiter");
+
+    m.def(
+        "rotate",
+        [](std::vector<FunctionTree<D, double> *> inp, const Eigen::MatrixXd &U) {
+            if (U.rows() != inp.size()) throw py::value_error("Expected U of shape (len(inp), nOut)");
+            py::gil_scoped_release release;
+            TreeLock lock(inp);
+            ProfileScope prof("rotate", inp);
+            auto out = mrcpp::rotate<D>(inp, U);
+            prof.output(out);
+            return out;
+        },
+        "inp"_a,
+        "U"_a,
+        R"mydelimiter(
+        Linear transformation of a list of trees, out_j = sum_i U_ij inp_i.
+
+        Returns the list of U.shape[1] output trees, all on the union grid of
+        the inputs. The grid is built once, and the outputs are computed in a
+        single parallel pass with one matrix product per node.
+        )mydelimiter");
 
     m.def(
         "prod",
         [](std::vector<FunctionTree<D, double> *> &inp) {
-            auto out = std::unique_ptr<FunctionTree<D, double>>(nullptr);
+            TreeLock lock(inp);
+            ProfileScope prof("prod", inp);
+            auto out = PyTreePtr<D>(nullptr);
             if (inp.size() > 0) {
                 auto &mra = inp[0]->getMRA();
-                out = std::make_unique<FunctionTree<D, double>>(mra);
+                out = make_tree<D>(mra);
+                prof.output(out);
                 FunctionTreeVector<D, double> vec;
                 for (auto* tree : inp) vec.push_back({1.0, tree});
                 build_grid(*out, vec); // Union grid
@@ -83,15 +174,19 @@ template <int D> void arithmetics(pybind11::module &m) {
             }
             return out;
         },
-        "inp"_a);
+        "inp"_a,
+        py::call_guard<py::gil_scoped_release>());
 
     m.def(
         "prod",
         [](std::vector<std::tuple<double, FunctionTree<D, double> *>> &inp) {
-            auto out = std::unique_ptr<FunctionTree<D, double>>(nullptr);
+            TreeLock lock(inp);
+            ProfileScope prof("prod", inp);
+            auto out = PyTreePtr<D>(nullptr);
             if (inp.size() > 0) {
                 auto &mra = std::get<1>(inp[0])->getMRA();
-                out = std::make_unique<FunctionTree<D, double>>(mra);
+                out = make_tree<D>(mra);
+                prof.output(out);
                 FunctionTreeVector<D, double> vec;
                 for (auto& t : inp) vec.push_back({std::get<0>(t), std::get<1>(t)});
                 build_grid(*out, vec); // Union grid
@@ -100,7 +195,8 @@ template <int D> void arithmetics(pybind11::module &m) {
             }
             return out;
         },
-        "inp"_a);
+        "inp"_a,
+        py::call_guard<py::gil_scoped_release>());
 }
 
 template <int D> void advanced_arithmetics(pybind11::module &m) {
@@ -110,6 +206,9 @@ template <int D> void advanced_arithmetics(pybind11::module &m) {
 
     m.def("add",
           [](double prec, FunctionTree<D, double> &out, double a, FunctionTree<D, double> &inp_a, double b, FunctionTree<D, double> &inp_b, int max_iter, bool abs_prec) {
+              TreeLock lock(&out, &inp_a, &inp_b);
+              ProfileScope prof("advanced.add", &inp_a, &inp_b);
+              prof.output(&out);
               mrcpp::add<D, double>(prec, out, a, inp_a, b, inp_b, max_iter, abs_prec);
           },
           "prec"_a = -1.0,
@@ -119,10 +218,14 @@ template <int D> void advanced_arithmetics(pybind11::module &m) {
           "b"_a = 1.0,
           "inp_b"_a,
           "max_iter"_a = -1,
-          "abs_prec"_a = false);
+          "abs_prec"_a = false,
+          py::call_guard<py::gil_scoped_release>());
 
     m.def("add",
           [](double prec, FunctionTree<D, double> &out, std::vector<FunctionTree<D, double> *> &inp, int max_iter, bool abs_prec) {
+              TreeLock lock(&out, inp);
+              ProfileScope prof("advanced.add", inp);
+              prof.output(&out);
               FunctionTreeVector<D, double> vec;
               for (auto* tree : inp) vec.push_back({1.0, tree});
               mrcpp::add<D, double>(prec, out, vec, max_iter, abs_prec);
@@ -131,10 +234,14 @@ template <int D> void advanced_arithmetics(pybind11::module &m) {
           "out"_a,
           "inp"_a,
           "max_iter"_a = -1,
-          "abs_prec"_a = false);
+          "abs_prec"_a = false,
+          py::call_guard<py::gil_scoped_release>());
 
     m.def("add",
           [](double prec, FunctionTree<D, double> &out, std::vector<std::tuple<double, FunctionTree<D, double> *>> &inp, int max_iter, bool abs_prec) {
+              TreeLock lock(&out, inp);
+              ProfileScope prof("advanced.add", inp);
+              prof.output(&out);
               FunctionTreeVector<D, double> vec;
               for (auto& t : inp) vec.push_back({std::get<0>(t), std::get<1>(t)});
               mrcpp::add<D, double>(prec, out, vec, max_iter, abs_prec);
@@ -143,10 +250,14 @@ template <int D> void advanced_arithmetics(pybind11::module &m) {
           "out"_a,
           "inp"_a,
           "max_iter"_a = -1,
-          "abs_prec"_a = false);
+          "abs_prec"_a = false,
+          py::call_guard<py::gil_scoped_release>());
 
     m.def("multiply",
           [](double prec, FunctionTree<D, double> &out, double c, FunctionTree<D, double> &inp_a, FunctionTree<D, double> &inp_b, int max_iter, bool abs_prec, bool use_max_norms) {
+              TreeLock lock(&out, &inp_a, &inp_b);
+              ProfileScope prof("advanced.multiply", &inp_a, &inp_b);
+              prof.output(&out);
               mrcpp::multiply<D, double>(prec, out, c, inp_a, inp_b, max_iter, abs_prec, use_max_norms);
           },
           "prec"_a = -1.0,
@@ -156,10 +267,14 @@ template <int D> void advanced_arithmetics(pybind11::module &m) {
           "inp_b"_a,
           "max_iter"_a = -1,
           "abs_prec"_a = false,
-          "use_max_norms"_a = false);
+          "use_max_norms"_a = false,
+          py::call_guard<py::gil_scoped_release>());
 
     m.def("multiply",
           [](double prec, FunctionTree<D, double> &out, std::vector<FunctionTree<D, double> *> &inp, int max_iter, bool abs_prec, bool use_max_norms) {
+              TreeLock lock(&out, inp);
+              ProfileScope prof("advanced.multiply", inp);
+              prof.output(&out);
               FunctionTreeVector<D, double> vec;
               for (auto* tree : inp) vec.push_back({1.0, tree});
               mrcpp::multiply<D, double>(prec, out, vec, max_iter, abs_prec, use_max_norms);
@@ -169,10 +284,14 @@ template <int D> void advanced_arithmetics(pybind11::module &m) {
           "inp"_a,
           "max_iter"_a = -1,
           "abs_prec"_a = false,
-          "use_max_norms"_a = false);
+          "use_max_norms"_a = false,
+          py::call_guard<py::gil_scoped_release>());
 
     m.def("multiply",
           [](double prec, FunctionTree<D, double> &out, std::vector<std::tuple<double, FunctionTree<D, double> *>> &inp, int max_iter, bool abs_prec, bool use_max_norms) {
+              TreeLock lock(&out, inp);
+              ProfileScope prof("advanced.multiply", inp);
+              prof.output(&out);
               FunctionTreeVector<D, double> vec;
               for (auto& t : inp) vec.push_back({std::get<0>(t), std::get<1>(t)});
               mrcpp::multiply<D, double>(prec, out, vec, max_iter, abs_prec, use_max_norms);
@@ -182,11 +301,15 @@ template <int D> void advanced_arithmetics(pybind11::module &m) {
           "inp"_a,
           "max_iter"_a = -1,
           "abs_prec"_a = false,
-          "use_max_norms"_a = false);
+          "use_max_norms"_a = false,
+          py::call_guard<py::gil_scoped_release>());
 
     m.def(
         "dot",
         [](double prec, FunctionTree<D, double> &out, std::vector<FunctionTree<D, double>*> &inp_a, std::vector<FunctionTree<D, double>*> &inp_b, int maxIter, bool abs_prec) {
+            TreeLock lock(&out, inp_a, inp_b);
+            ProfileScope prof("advanced.dot", inp_a, inp_b);
+            prof.output(&out);
             FunctionTreeVector<D, double> vec_a, vec_b;
             for (auto* t : inp_a) vec_a.push_back({1.0, t});
             for (auto* t : inp_b) vec_b.push_back({1.0, t});
@@ -197,10 +320,14 @@ template <int D> void advanced_arithmetics(pybind11::module &m) {
         "inp_a"_a,
         "inp_b"_a,
         "maxIter"_a = -1,
-        "abs_prec"_a = false);
+        "abs_prec"_a = false,
+        py::call_guard<py::gil_scoped_release>());
 
     m.def("power",
           [](double prec, FunctionTree<D, double> &out, FunctionTree<D, double> &inp, double pow, int max_iter, bool abs_prec) {
+              TreeLock lock(&out, &inp);
+              ProfileScope prof("advanced.power", &inp);
+              prof.output(&out);
               mrcpp::power<D, double>(prec, out, inp, pow, max_iter, abs_prec);
           },
           "prec"_a = -1.0,
@@ -208,16 +335,21 @@ template <int D> void advanced_arithmetics(pybind11::module &m) {
           "inp"_a,
           "pow"_a,
           "max_iter"_a = -1,
-          "abs_prec"_a = false);
+          "abs_prec"_a = false,
+          py::call_guard<py::gil_scoped_release>());
 
     m.def("square",
           [](double prec, FunctionTree<D, double> &out, FunctionTree<D, double> &inp, int max_iter, bool abs_prec) {
+              TreeLock lock(&out, &inp);
+              ProfileScope prof("advanced.square", &inp);
+              prof.output(&out);
               mrcpp::square<D, double>(prec, out, inp, max_iter, abs_prec);
           },
           "prec"_a = -1.0,
           "out"_a,
           "inp"_a,
           "max_iter"_a = -1,
-          "abs_prec"_a = false);
+          "abs_prec"_a = false,
+          py::call_guard<py::gil_scoped_release>());
 }
 } // namespace vampyr
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <pybind11/operators.h>
+#include <pybind11/pybind11.h>
+
+#include "PyExpression.h"
+#include "core/Profiler.h"
+#include "trees/TreeLock.h"
+
+namespace vampyr {
+
+template <int D> void expressions(pybind11::module &m) {
+    using namespace mrcpp;
+    namespace py = pybind11;
+    using namespace pybind11::literals;
+
+    // Expressions only refer to their trees, keep_alive makes sure the trees outlive them
+    py::class_<PyExpression<D>>(m,
+                                "Expression",
+                                R"mydelimiter(
+        Lazily evaluated arithmetic expression of function trees.
+
+        Sums, differences, scalings and products of expressions (or of an
+        expression and a FunctionTree) do not compute anything. Calling
+        materialize() builds the union grid of all trees involved once and
+        evaluates the whole expression in a single parallel pass over its
+        nodes, without intermediate trees.
+    )mydelimiter")
+        .def(py::init<FunctionTree<D, double> &>(), "tree"_a, py::keep_alive<1, 2>())
+        .def("nTerms", &PyExpression<D>::getNTerms)
+        .def("degree", &PyExpression<D>::getDegree)
+        .def(
+            "materialize",
+            [](const PyExpression<D> &expr, double prec, int max_iter, bool abs_prec) {
+                auto trees = expr.getTrees();
+                TreeLock lock(trees);
+                ProfileScope prof("Expression.materialize", trees);
+                auto out = expr(prec, max_iter, abs_prec);
+                prof.output(out);
+                return out;
+            },
+            "prec"_a = -1.0,
+            "max_iter"_a = -1,
+            "abs_prec"_a = false,
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "__add__",
+            [](const PyExpression<D> &a, const PyExpression<D> &b) { return a + b; },
+            py::is_operator(),
+            py::keep_alive<0, 1>(),
+            py::keep_alive<0, 2>())
+        .def(
+            "__radd__",
+            [](const PyExpression<D> &a, const PyExpression<D> &b) { return b + a; },
+            py::is_operator(),
+            py::keep_alive<0, 1>(),
+            py::keep_alive<0, 2>())
+        .def(
+            "__sub__",
+            [](const PyExpression<D> &a, const PyExpression<D> &b) { return a + b * -1.0; },
+            py::is_operator(),
+            py::keep_alive<0, 1>(),
+            py::keep_alive<0, 2>())
+        .def(
+            "__rsub__",
+            [](const PyExpression<D> &a, const PyExpression<D> &b) { return b + a * -1.0; },
+            py::is_operator(),
+            py::keep_alive<0, 1>(),
+            py::keep_alive<0, 2>())
+        .def(
+            "__mul__",
+            [](const PyExpression<D> &a, const PyExpression<D> &b) { return a * b; },
+            py::is_operator(),
+            py::keep_alive<0, 1>(),
+            py::keep_alive<0, 2>())
+        .def(
+            "__mul__", [](const PyExpression<D> &a, double c) { return a * c; }, py::is_operator(), py::keep_alive<0, 1>())
+        .def(
+            "__rmul__",
+            [](const PyExpression<D> &a, const PyExpression<D> &b) { return b * a; },
+            py::is_operator(),
+            py::keep_alive<0, 1>(),
+            py::keep_alive<0, 2>())
+        .def(
+            "__rmul__", [](const PyExpression<D> &a, double c) { return a * c; }, py::is_operator(), py::keep_alive<0, 1>())
+        .def(
+            "__truediv__",
+            [](const PyExpression<D> &a, double c) { return a * (1.0 / c); },
+            py::is_operator(),
+            py::keep_alive<0, 1>())
+        .def(
+            "__pow__",
+            [](const PyExpression<D> &a, int n) {
+                if (n < 1) throw py::value_error("Only positive integer powers of expressions are supported");
+                auto out = a;
+                for (int i = 1; i < n; i++) out = out * a;
+                return out;
+            },
+            py::is_operator(),
+            py::keep_alive<0, 1>())
+        .def("__pos__", [](const PyExpression<D> &a) { return a; }, py::is_operator(), py::keep_alive<0, 1>())
+        .def(
+            "__neg__", [](const PyExpression<D> &a) { return a * -1.0; }, py::is_operator(), py::keep_alive<0, 1>());
+
+    py::implicitly_convertible<FunctionTree<D, double>, PyExpression<D>>();
+
+    m.def(
+        "lazy",
+        [](FunctionTree<D, double> &tree) { return PyExpression<D>(tree); },
+        "tree"_a,
+        py::keep_alive<0, 1>(),
+        "Start a lazily evaluated expression from a FunctionTree");
+}
+
+} // namespace vampyr
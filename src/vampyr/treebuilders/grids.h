@@ -5,6 +5,9 @@
 
 #include <MRCPP/treebuilders/grid.h>
 
+#include "core/Profiler.h"
+#include "trees/TreeLock.h"
+
 namespace vampyr {
 
 template <int D> void grids(pybind11::module &m) {
@@ -14,18 +17,28 @@ template <int D> void grids(pybind11::module &m) {
 
     m.def(
         "build_grid",
-        [](FunctionTree<D, double> &out, int scales) { build_grid<D, double>(out, scales); },
+        [](FunctionTree<D, double> &out, int scales) {
+            TreeLock lock(&out);
+            ProfileScope prof("build_grid");
+            prof.output(&out);
+            build_grid<D, double>(out, scales);
+        },
         "out"_a,
-        "scales"_a);
+        "scales"_a,
+        py::call_guard<py::gil_scoped_release>());
 
     m.def(
         "build_grid",
         [](FunctionTree<D, double> &out, FunctionTree<D, double> &inp, int max_iter) {
+            TreeLock lock(&out, &inp);
+            ProfileScope prof("build_grid", &inp);
+            prof.output(&out);
             build_grid<D, double>(out, inp, max_iter);
         },
         "out"_a,
         "inp"_a,
-        "max_iter"_a = -1);
+        "max_iter"_a = -1,
+        py::call_guard<py::gil_scoped_release>());
 }
 
 template <int D> void advanced_grids(pybind11::module &m) {
@@ -35,83 +48,143 @@ template <int D> void advanced_grids(pybind11::module &m) {
 
     m.def(
         "build_grid",
-        [](FunctionTree<D, double> &out, int scales) { build_grid<D, double>(out, scales); },
+        [](FunctionTree<D, double> &out, int scales) {
+            TreeLock lock(&out);
+            ProfileScope prof("advanced.build_grid");
+            prof.output(&out);
+            build_grid<D, double>(out, scales);
+        },
         "out"_a,
-        "scales"_a);
+        "scales"_a,
+        py::call_guard<py::gil_scoped_release>());
 
     m.def(
         "build_grid",
         [](FunctionTree<D, double> &out, FunctionTree<D, double> &inp, int max_iter) {
+            TreeLock lock(&out, &inp);
+            ProfileScope prof("advanced.build_grid", &inp);
+            prof.output(&out);
             build_grid<D, double>(out, inp, max_iter);
         },
         "out"_a,
         "inp"_a,
-        "max_iter"_a = -1);
+        "max_iter"_a = -1,
+        py::call_guard<py::gil_scoped_release>());
 
     m.def(
         "build_grid",
         [](FunctionTree<D, double> &out, const RepresentableFunction<D, double> &inp, int max_iter) {
+            TreeLock lock(&out);
+            ProfileScope prof("advanced.build_grid");
+            prof.output(&out);
             build_grid<D, double>(out, inp, max_iter);
         },
         "out"_a,
         "inp"_a,
-        "max_iter"_a = -1);
+        "max_iter"_a = -1,
+        py::call_guard<py::gil_scoped_release>());
 
     m.def(
         "build_grid",
         [](FunctionTree<D, double> &out, std::vector<FunctionTree<D, double> *> &inp, int max_iter) {
+            TreeLock lock(&out, inp);
+            ProfileScope prof("advanced.build_grid", inp);
+            prof.output(&out);
             FunctionTreeVector<D, double> vec;
             for (auto *tree : inp) vec.push_back({1.0, tree});
             build_grid<D, double>(out, vec, max_iter);
         },
         "out"_a,
         "inp"_a,
-        "max_iter"_a = -1);
+        "max_iter"_a = -1,
+        py::call_guard<py::gil_scoped_release>());
 
     m.def(
         "build_grid",
         [](FunctionTree<D, double> &out, std::vector<std::tuple<double, FunctionTree<D, double> *>> &inp, int max_iter) {
+            TreeLock lock(&out, inp);
+            ProfileScope prof("advanced.build_grid", inp);
+            prof.output(&out);
             FunctionTreeVector<D, double> vec;
             for (auto &t : inp) vec.push_back({std::get<0>(t), std::get<1>(t)});
             build_grid<D, double>(out, vec, max_iter);
         },
         "out"_a,
         "inp"_a,
-        "max_iter"_a = -1);
+        "max_iter"_a = -1,
+        py::call_guard<py::gil_scoped_release>());
 
     m.def(
         "copy_grid",
-        [](FunctionTree<D, double> &out, FunctionTree<D, double> &inp) { copy_grid<D, double>(out, inp); },
+        [](FunctionTree<D, double> &out, FunctionTree<D, double> &inp) {
+            TreeLock lock(&out, &inp);
+            ProfileScope prof("advanced.copy_grid", &inp);
+            prof.output(&out);
+            copy_grid<D, double>(out, inp);
+        },
         "out"_a,
-        "inp"_a);
+        "inp"_a,
+        py::call_guard<py::gil_scoped_release>());
 
     m.def(
         "copy_func",
-        [](FunctionTree<D, double> &out, FunctionTree<D, double> &inp) { copy_func<D, double>(out, inp); },
+        [](FunctionTree<D, double> &out, FunctionTree<D, double> &inp) {
+            TreeLock lock(&out, &inp);
+            ProfileScope prof("advanced.copy_func", &inp);
+            prof.output(&out);
+            copy_func<D, double>(out, inp);
+        },
         "out"_a,
-        "inp"_a);
+        "inp"_a,
+        py::call_guard<py::gil_scoped_release>());
 
     m.def(
-        "clear_grid", [](FunctionTree<D, double> &out) { clear_grid<D, double>(out); }, "out"_a);
+        "clear_grid",
+        [](FunctionTree<D, double> &out) {
+            TreeLock lock(&out);
+            ProfileScope prof("advanced.clear_grid");
+            prof.output(&out);
+            clear_grid<D, double>(out);
+        },
+        "out"_a,
+        py::call_guard<py::gil_scoped_release>());
 
     m.def(
         "refine_grid",
-        [](FunctionTree<D, double> &out, int scales) { return refine_grid<D, double>(out, scales); },
+        [](FunctionTree<D, double> &out, int scales) {
+            TreeLock lock(&out);
+            ProfileScope prof("advanced.refine_grid");
+            prof.output(&out);
+            return refine_grid<D, double>(out, scales);
+        },
         "out"_a,
-        "scales"_a);
+        "scales"_a,
+        py::call_guard<py::gil_scoped_release>());
 
     m.def(
         "refine_grid",
-        [](FunctionTree<D, double> &out, double prec, bool abs_prec) { return refine_grid<D, double>(out, prec, abs_prec); },
+        [](FunctionTree<D, double> &out, double prec, bool abs_prec) {
+            TreeLock lock(&out);
+            ProfileScope prof("advanced.refine_grid");
+            prof.output(&out);
+            return refine_grid<D, double>(out, prec, abs_prec);
+        },
         "out"_a,
         "prec"_a,
-        "abs_prec"_a = false);
+        "abs_prec"_a = false,
+        py::call_guard<py::gil_scoped_release>());
 
     m.def(
         "refine_grid",
-        [](FunctionTree<D, double> &out, FunctionTree<D, double> &inp) { return refine_grid<D, double>(out, inp); },
+        [](FunctionTree<D, double> &out, FunctionTree<D, double> &inp) {
+            TreeLock lock(&out, &inp);
+            ProfileScope prof("advanced.refine_grid", &inp);
+            prof.output(&out);
+            return refine_grid<D, double>(out, inp);
+        },
         "out"_a,
-        "inp"_a);
+        "inp"_a,
+        py::call_guard<py::gil_scoped_release>());
 }
 
 } // namespace vampyr
@@ -1,28 +1,155 @@
 #pragma once
 
+#include <memory>
+
 #include <pybind11/functional.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
 
 #include "PyFunctionMap.h"
+#include "PyMapKernel.h"
+#include "core/arrays.h"
+#include "core/Profiler.h"
+#include "trees/TreeLock.h"
 #include <MRCPP/treebuilders/map.h>
 
 namespace vampyr {
+
+// Wraps a vectorized Python callable, mapping a 1D array of values to an
+// array of the same size, as a batch map. The values are passed as a
+// read-only array over the batch buffer, which is only valid during the call.
+// The callable is kept alive by the returned function, which may be copied
+// and called with the GIL released.
+inline mrcpp::BatchMap make_batch_map(pybind11::object fmap) {
+    namespace py = pybind11;
+    std::shared_ptr<py::object> func(new py::object(std::move(fmap)), [](py::object *f) {
+        py::gil_scoped_acquire acquire;
+        delete f;
+    });
+    return [func](const std::vector<double> &inp, std::vector<double> &out) {
+        py::gil_scoped_acquire acquire;
+        auto n = static_cast<py::ssize_t>(inp.size());
+        auto x = readonly_array(inp, {n});
+        auto y = py::array_t<double, py::array::c_style | py::array::forcecast>::ensure((*func)(x));
+        if (!y || y.size() != n) throw std::runtime_error("Vectorized map must return one value per input value");
+        std::copy(y.data(), y.data() + n, out.begin());
+    };
+}
+
+// Wraps a Python callable, taking a single value as argument, as a batch map
+// that calls it once per value. The calls are made from the calling thread,
+// so the rest of the map still runs in parallel. The callable is kept alive
+// by the returned function, which may be copied and called with the GIL
+// released.
+inline mrcpp::BatchMap make_pointwise_map(pybind11::object fmap) {
+    namespace py = pybind11;
+    std::shared_ptr<py::object> func(new py::object(std::move(fmap)), [](py::object *f) {
+        py::gil_scoped_acquire acquire;
+        delete f;
+    });
+    return [func](const std::vector<double> &inp, std::vector<double> &out) {
+        py::gil_scoped_acquire acquire;
+        for (size_t i = 0; i < inp.size(); i++) out[i] = (*func)(inp[i]).cast<double>();
+    };
+}
+
+inline void map_kernels(pybind11::module &m) {
+    using namespace mrcpp;
+    namespace py = pybind11;
+    using namespace pybind11::literals;
+
+    py::enum_<MapKernelType>(m, "MapKernelType")
+        .value("Exp", MapKernelType::Exp)
+        .value("Log", MapKernelType::Log)
+        .value("Log1p", MapKernelType::Log1p)
+        .value("Sqrt", MapKernelType::Sqrt)
+        .value("Abs", MapKernelType::Abs)
+        .value("Pow", MapKernelType::Pow)
+        .value("Inverse", MapKernelType::Inverse)
+        .value("Clamp", MapKernelType::Clamp)
+        .value("Scale", MapKernelType::Scale);
+
+    py::class_<PyMapKernel>(m,
+                            "MapKernel",
+                            // clang-format off
+    R"mydelimiter(
+        Built-in map of function values, for FunctionMap and advanced.map.
+
+        Selected by name or MapKernelType, with the parameters of the kernel:
+
+            exp, log, log1p, sqrt, abs
+            pow(p)                     x^p
+            inverse(cutoff=0)          1/x where |x| > cutoff, 0 elsewhere
+            clamp(lower=-inf, upper=inf)
+            scale(a)                   a*x
+
+        Kernels are composed with then() or >>, e.g.
+        MapKernel("clamp", [0.0]) >> MapKernel("pow", [1/3]). The maps run
+        natively on all MRCPP threads, without calling back into Python.
+    )mydelimiter")
+        // clang-format on
+        .def(py::init<MapKernelType, const std::vector<double> &>(), "kernel"_a, "params"_a = std::vector<double>())
+        .def(py::init<const std::string &, const std::vector<double> &>(), "kernel"_a, "params"_a = std::vector<double>())
+        .def("then", &PyMapKernel::then, "next"_a, "Composed map, applying this map first and then next.")
+        .def("__rshift__", &PyMapKernel::then)
+        .def(
+            "__call__",
+            [](const PyMapKernel &K, py::array_t<double, py::array::c_style | py::array::forcecast> x) {
+                py::array_t<double> out(x.request().shape);
+                std::copy(x.data(), x.data() + x.size(), out.mutable_data());
+                auto *vals = out.mutable_data();
+                auto n = static_cast<int>(out.size());
+                {
+                    py::gil_scoped_release release;
+                    K.apply(vals, n);
+                }
+                return out;
+            },
+            "x"_a)
+        .def("__repr__", [](const PyMapKernel &K) { return "MapKernel(" + K.str() + ")"; });
+
+    py::implicitly_convertible<std::string, PyMapKernel>();
+    py::implicitly_convertible<MapKernelType, PyMapKernel>();
+}
+
 template <int D> void map(pybind11::module &m) {
     using namespace mrcpp;
     namespace py = pybind11;
     using namespace pybind11::literals;
 
     py::class_<PyFunctionMap<D>>(m, "FunctionMap")
-        .def(py::init<std::function<double(double)>, double>(), "fmap"_a, "prec"_a)
+        .def(py::init([](const PyMapKernel &fmap, double prec) { return PyFunctionMap<D>(BatchMap(fmap), prec); }),
+             "fmap"_a,
+             "prec"_a,
+             "Map of function values through a built-in MapKernel, or a kernel name, on all MRCPP threads.")
+        .def(py::init([](py::function fmap, double prec, bool vectorized) {
+                 if (vectorized) return PyFunctionMap<D>(make_batch_map(fmap), prec);
+                 return PyFunctionMap<D>(make_pointwise_map(fmap), prec);
+             }),
+             "fmap"_a,
+             "prec"_a,
+             "vectorized"_a = false,
+             R"mydelimiter(
+             Map of function values, out(r) = fmap(inp(r)).
+
+             By default fmap is called once per value, with a float as
+             argument. With vectorized=True it is called once per refinement
+             iteration with a 1D NumPy array of all values, e.g. a ufunc like
+             numpy.exp, and must return an array of the same size, which avoids
+             the overhead of a Python call per value. In both cases fmap is
+             called from the calling thread, and the tree is built in parallel.
+             )mydelimiter")
         .def(
             "__call__",
             [](PyFunctionMap<D> &F, FunctionTree<D, double> &inp) {
-                auto old_threads = mrcpp_get_num_threads();
-                set_max_threads(1);
+                TreeLock lock(&inp);
+                ProfileScope prof("FunctionMap.__call__", &inp);
                 auto out = F(inp);
-                set_max_threads(old_threads);
+                prof.output(out);
                 return out;
             },
-            "inp"_a);
+            "inp"_a,
+            py::call_guard<py::gil_scoped_release>());
 }
 
 template <int D> void advanced_map(pybind11::module &m) {
@@ -30,24 +157,53 @@ template <int D> void advanced_map(pybind11::module &m) {
     namespace py = pybind11;
     using namespace pybind11::literals;
 
+    m.def(
+        "map",
+        [](double prec, FunctionTree<D, double> &out, FunctionTree<D, double> &inp, const PyMapKernel &fmap, int max_iter, bool abs_prec) {
+            TreeLock lock(&out, &inp);
+            ProfileScope prof("advanced.map", &inp);
+            prof.output(&out);
+            batch_map<D>(prec, out, inp, BatchMap(fmap), max_iter, abs_prec);
+        },
+        "prec"_a = -1.0,
+        "out"_a,
+        "inp"_a,
+        "fmap"_a,
+        "max_iter"_a = -1,
+        "abs_prec"_a = false,
+        py::call_guard<py::gil_scoped_release>(),
+        "Map the values of inp through a built-in MapKernel, or a kernel name, into out.");
+
     m.def(
         "map",
         [](double prec,
            FunctionTree<D, double> &out,
            FunctionTree<D, double> &inp,
-           std::function<double(double)> fmap,
+           py::function fmap,
            int max_iter,
-           bool abs_prec) {
-            auto old_threads = mrcpp_get_num_threads();
-            mrcpp::set_max_threads(1);
-            mrcpp::map<D>(prec, out, inp, fmap, max_iter, abs_prec);
-            mrcpp::set_max_threads(old_threads);
+           bool abs_prec,
+           bool vectorized) {
+            auto batch = vectorized ? make_batch_map(fmap) : make_pointwise_map(fmap);
+            py::gil_scoped_release release;
+            TreeLock lock(&out, &inp);
+            ProfileScope prof("advanced.map", &inp);
+            prof.output(&out);
+            batch_map<D>(prec, out, inp, batch, max_iter, abs_prec);
         },
         "prec"_a = -1.0,
         "out"_a,
         "inp"_a,
         "fmap"_a,
         "max_iter"_a = -1,
-        "abs_prec"_a = false);
+        "abs_prec"_a = false,
+        "vectorized"_a = false,
+        R"mydelimiter(
+        Map the values of inp through fmap into out.
+
+        With vectorized=True, fmap is called once per refinement iteration
+        with a 1D NumPy array of all values and must return an array of the
+        same size. Otherwise it is called once per value. In both cases fmap
+        is called from the calling thread, and the tree is built in parallel.
+        )mydelimiter");
 }
 } // namespace vampyr
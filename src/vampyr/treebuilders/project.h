@@ -1,10 +1,50 @@
 #pragma once
 
 #include <pybind11/functional.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
 
 #include "PyProjectors.h"
+#include "core/arrays.h"
+#include "core/Profiler.h"
+#include "trees/TreeLock.h"
 
 namespace vampyr {
+
+// Wraps a vectorized Python callable, taking an (N, D) array of points and
+// returning N values, as a batch function. The points are passed as a
+// read-only array over the batch buffer, which is only valid during the call.
+// The handle is not owned, so the callable must outlive the projection.
+// Called with the GIL released.
+template <int D> mrcpp::BatchFunction make_batch_function(pybind11::handle func) {
+    namespace py = pybind11;
+    return [func](const std::vector<double> &pts, std::vector<double> &vals) {
+        py::gil_scoped_acquire acquire;
+        auto n = static_cast<py::ssize_t>(vals.size());
+        auto r = readonly_array(pts, {n, static_cast<py::ssize_t>(D)});
+        auto f = py::array_t<double, py::array::c_style | py::array::forcecast>::ensure(func(r));
+        if (!f || f.size() != n) throw std::runtime_error("Vectorized function must return one value per point");
+        std::copy(f.data(), f.data() + n, vals.begin());
+    };
+}
+
+// Wraps a Python callable, taking a single point as argument, as a batch
+// function that calls it once per point. The calls are made from the calling
+// thread, so the rest of the projection still runs in parallel. The handle is
+// not owned, so the callable must outlive the projection. Called with the GIL
+// released.
+template <int D> mrcpp::BatchFunction make_pointwise_function(pybind11::handle func) {
+    namespace py = pybind11;
+    return [func](const std::vector<double> &pts, std::vector<double> &vals) {
+        py::gil_scoped_acquire acquire;
+        mrcpp::Coord<D> r;
+        for (size_t i = 0; i < vals.size(); i++) {
+            std::copy(pts.begin() + i * D, pts.begin() + (i + 1) * D, r.begin());
+            vals[i] = func(r).template cast<double>();
+        }
+    };
+}
+
 template <int D> void project(pybind11::module &m) {
     using namespace mrcpp;
     namespace py = pybind11;
@@ -13,7 +53,7 @@ template <int D> void project(pybind11::module &m) {
     m.def(
         "ZeroTree",
         [](const MultiResolutionAnalysis<D> &mra, const std::string &name) {
-            auto out = std::make_unique<FunctionTree<D, double>>(mra, name);
+            auto out = make_tree<D>(mra, name);
             out->setZero();
             return out;
         },
@@ -23,53 +63,73 @@ template <int D> void project(pybind11::module &m) {
     py::class_<PyScalingProjector<D>>(m, "ScalingProjector")
         .def(py::init<const MultiResolutionAnalysis<D> &, double>(), "mra"_a, "prec"_a)
         .def(py::init<const MultiResolutionAnalysis<D> &, int>(), "mra"_a, "scale"_a)
-        .def(
-            "__call__", [](PyScalingProjector<D> &P, RepresentableFunction<D, double> &func) { return P(func); }, "func"_a)
         .def(
             "__call__",
-            [](PyScalingProjector<D> &P, std::function<double(const Coord<D> &r)> func) {
-                try {
-                    // When the analytic function func is badly defined, it kills the kernel
-                    // of Notebooks. This evaluates func in a point, and if it is not successful
-                    // it throws an error instead of killing the kernel.
-                    auto arr = std::array<double, D>();
-                    arr.fill(111111.111); // A number which hopefully does not divide by zero
-                    func(arr);
-                } catch (py::cast_error &e) {
-                    py::print("Error: Invalid definition of analytic function");
-                    throw;
-                }
-                auto old_threads = mrcpp_get_num_threads();
-                set_max_threads(1);
+            [](PyScalingProjector<D> &P, RepresentableFunction<D, double> &func) {
+                ProfileScope prof("ScalingProjector.__call__");
                 auto out = P(func);
-                set_max_threads(old_threads);
+                prof.output(out);
+                return out;
+            },
+            "func"_a,
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "__call__",
+            [](PyScalingProjector<D> &P, py::function inp, bool vectorized) {
+                auto batch = vectorized ? make_batch_function<D>(inp) : make_pointwise_function<D>(inp);
+                py::gil_scoped_release release;
+                ProfileScope prof("ScalingProjector.__call__");
+                auto out = P(batch);
+                prof.output(out);
                 return out;
             },
-            "func"_a);
+            "func"_a,
+            "vectorized"_a = false,
+            R"mydelimiter(
+            Project an analytic function given as a Python callable.
+
+            By default the function is called once per quadrature point, with
+            a single point as argument. With vectorized=True it is called once
+            per refinement iteration with an (N, D) NumPy array of points, and
+            must return an array of N values, which avoids the overhead of a
+            Python call per point. In both cases the function is called from
+            the calling thread, and the tree is built in parallel.
+            )mydelimiter");
 
     py::class_<PyWaveletProjector<D>>(m, "WaveletProjector")
         .def(py::init<const MultiResolutionAnalysis<D> &, int>(), "mra"_a, "scale"_a)
-        .def(
-            "__call__", [](PyWaveletProjector<D> &P, RepresentableFunction<D, double> &func) { return P(func); }, "func"_a)
         .def(
             "__call__",
-            [](PyWaveletProjector<D> &P, std::function<double(const Coord<D> &r)> func) {
-                try {
-                    auto arr = std::array<double, D>();
-                    arr.fill(111111.111); // A number which hopefully does not divide by zero
-                    func(arr);
-                } catch (py::cast_error &e) {
-                    py::print("Error: Invalid definition of analytic function");
-                    throw;
-                }
-
-                auto old_threads = mrcpp_get_num_threads();
-                set_max_threads(1);
+            [](PyWaveletProjector<D> &P, RepresentableFunction<D, double> &func) {
+                ProfileScope prof("WaveletProjector.__call__");
                 auto out = P(func);
-                set_max_threads(old_threads);
+                prof.output(out);
                 return out;
             },
-            "func"_a);
+            "func"_a,
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "__call__",
+            [](PyWaveletProjector<D> &P, py::function inp, bool vectorized) {
+                auto batch = vectorized ? make_batch_function<D>(inp) : make_pointwise_function<D>(inp);
+                py::gil_scoped_release release;
+                ProfileScope prof("WaveletProjector.__call__");
+                auto out = P(batch);
+                prof.output(out);
+                return out;
+            },
+            "func"_a,
+            "vectorized"_a = false,
+            R"mydelimiter(
+            Project an analytic function given as a Python callable.
+
+            By default the function is called once per quadrature point, with
+            a single point as argument. With vectorized=True it is called once
+            per refinement iteration with an (N, D) NumPy array of points, and
+            must return an array of N values, which avoids the overhead of a
+            Python call per point. In both cases the function is called from
+            the calling thread, and the tree is built in parallel.
+            )mydelimiter");
 }
 
 template <int D> void advanced_project(pybind11::module &m) {
@@ -79,30 +139,33 @@ template <int D> void advanced_project(pybind11::module &m) {
 
     m.def("project",
           [](double prec, FunctionTree<D, double> &out, RepresentableFunction<D, double> &inp, int max_iter, bool abs_prec) {
-              mrcpp::project<D, double>(prec, out, inp, max_iter, abs_prec);
+              TreeLock lock(&out);
+              ProfileScope prof("advanced.project");
+              prof.output(&out);
+              mrcpp::project_function<D>(prec, out, inp, max_iter, abs_prec);
           },
           "prec"_a = -1.0,
           "out"_a,
           "inp"_a,
           "max_iter"_a = -1,
-          "abs_prec"_a = false);
+          "abs_prec"_a = false,
+          py::call_guard<py::gil_scoped_release>());
 
     m.def(
         "project",
-        [](double prec,
-           FunctionTree<D, double> &out,
-           std::function<double(const Coord<D> &r)> inp,
-           int max_iter,
-           bool abs_prec) {
-            auto old_threads = mrcpp_get_num_threads();
-            mrcpp::set_max_threads(1);
-            mrcpp::project<D>(prec, out, inp, max_iter, abs_prec);
-            mrcpp::set_max_threads(old_threads);
+        [](double prec, FunctionTree<D, double> &out, py::function inp, int max_iter, bool abs_prec, bool vectorized) {
+            auto batch = vectorized ? make_batch_function<D>(inp) : make_pointwise_function<D>(inp);
+            py::gil_scoped_release release;
+            TreeLock lock(&out);
+            ProfileScope prof("advanced.project");
+            prof.output(&out);
+            mrcpp::batch_project<D>(prec, out, batch, max_iter, abs_prec);
         },
         "prec"_a = -1.0,
         "out"_a,
         "inp"_a,
         "max_iter"_a = -1,
-        "abs_prec"_a = false);
+        "abs_prec"_a = false,
+        "vectorized"_a = false);
 }
 } // namespace vampyr
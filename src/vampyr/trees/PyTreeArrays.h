@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include <MRCPP/treebuilders/DefaultCalculator.h>
+#include <MRCPP/treebuilders/TreeBuilder.h>
+#include <MRCPP/trees/MWTree.h>
+#include <MRCPP/trees/TreeIterator.h>
+
+#include "treebuilders/PyIndexAdaptor.h"
+
+namespace mrcpp {
+
+/*
+ * Flat array representation of an MW tree: one row per node, holding
+ * its scale, its D translations and its full set of MW coefficients. Nodes
+ * are listed top-down, so every parent precedes its children.
+ */
+
+/** @returns All allocated nodes of the tree in top-down order, without GenNodes */
+template <int D> std::vector<MWNode<D, double> *> tree_nodes(MWTree<D, double> &tree) {
+    std::vector<MWNode<D, double> *> nodes;
+    nodes.reserve(tree.getNNodes());
+    TreeIterator<D, double> it(tree, TopDown, Lebesgue);
+    it.setReturnGenNodes(false);
+    while (it.next()) nodes.push_back(&it.getNode());
+    return nodes;
+}
+
+/** Copies scales (N), translations (N, D) and coefficients (N, nCoefs) of the nodes */
+template <int D>
+void write_tree_arrays(const std::vector<MWNode<D, double> *> &nodes, int *scales, int *translations, double *coefs) {
+    int nNodes = nodes.size();
+#pragma omp parallel for schedule(static) num_threads(mrcpp_get_num_threads())
+    for (int n = 0; n < nNodes; n++) {
+        const MWNode<D, double> &node = *nodes[n];
+        const NodeIndex<D> &idx = node.getNodeIndex();
+        int nCoefs = node.getNCoefs();
+        double *c = coefs + static_cast<size_t>(n) * nCoefs;
+        scales[n] = idx.getScale();
+        for (int d = 0; d < D; d++) translations[n * D + d] = idx.getTranslation(d);
+        if (node.hasCoefs()) {
+            std::copy(node.getCoefs(), node.getCoefs() + nCoefs, c);
+        } else {
+            std::fill(c, c + nCoefs, 0.0);
+        }
+    }
+}
+
+/*
+ * Rebuilds a tree from the given rows of its array representation. The grid
+ * is created in one TreeBuilder pass, after which the end node coefficients
+ * are copied in parallel and the branch nodes are recomputed by a bottom-up
+ * transform. It is thus sufficient to provide the end nodes, in any order.
+ * End nodes that are not listed (incomplete input) are zeroed. Only the
+ * coefficients of the selected rows are read.
+ */
+template <int D>
+void read_tree_rows(MWTree<D, double> &tree, const std::vector<int> &rows, const int *scales, const int *translations, const double *coefs) {
+    using Key = typename PyIndexAdaptor<D>::Key;
+    const auto &mra = tree.getMRA();
+    int rootScale = mra.getRootScale();
+    int maxScale = mra.getMaxScale();
+
+    std::vector<Key> keys(rows.size());
+    std::map<Key, int> lookup;
+    for (int i = 0; i < rows.size(); i++) {
+        int n = rows[i];
+        if (scales[n] < rootScale or scales[n] > maxScale) throw std::invalid_argument("Node scale outside of MRA scale range");
+        keys[i].first = scales[n];
+        for (int d = 0; d < D; d++) keys[i].second[d] = translations[n * D + d];
+        lookup[keys[i]] = n;
+    }
+
+    tree.clear();
+    TreeBuilder<D, double> builder;
+    DefaultCalculator<D, double> calculator;
+    PyIndexAdaptor<D> adaptor(rootScale, maxScale, keys);
+    builder.build(tree, calculator, adaptor, -1);
+
+    int nEndNodes = tree.getNEndNodes();
+#pragma omp parallel for schedule(static) num_threads(mrcpp_get_num_threads())
+    for (int i = 0; i < nEndNodes; i++) {
+        MWNode<D, double> &node = tree.getEndMWNode(i);
+        int nCoefs = node.getNCoefs();
+        double *c = node.getCoefs();
+        auto row = lookup.find(PyIndexAdaptor<D>::makeKey(node.getNodeIndex()));
+        if (row != lookup.end()) {
+            const double *src = coefs + static_cast<size_t>(row->second) * nCoefs;
+            std::copy(src, src + nCoefs, c);
+        } else {
+            std::fill(c, c + nCoefs, 0.0);
+        }
+        node.setHasCoefs();
+        node.calcNorms();
+    }
+    tree.mwTransform(BottomUp);
+    tree.calcSquareNorm();
+}
+
+/** Rebuilds a tree from all nNodes rows of its array representation */
+template <int D>
+void read_tree_arrays(MWTree<D, double> &tree, int nNodes, const int *scales, const int *translations, const double *coefs) {
+    std::vector<int> rows(nNodes);
+    std::iota(rows.begin(), rows.end(), 0);
+    read_tree_rows<D>(tree, rows, scales, translations, coefs);
+}
+
+} // namespace mrcpp
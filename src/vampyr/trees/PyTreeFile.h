@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <MRCPP/trees/FunctionTree.h>
+
+#include "PyTreeArrays.h"
+
+namespace mrcpp {
+
+/*
+ * Versioned binary tree container, designed to be memory mapped:
+ *
+ *   header       PyTreeFileHeader, describing the MRA, its world box and
+ *                the section offsets
+ *   index table  nNodes rows of (scale, l_1, ..., l_D) as int32
+ *   coefficients nNodes rows of nCoefs doubles, starting at a page boundary
+ *
+ * Nodes are stored top-down, as in the array representation of the tree,
+ * so the coefficients of every node (including branch nodes) are available.
+ * Opening a file maps it without reading, and loading a tree only touches
+ * the coefficient pages of the selected nodes.
+ */
+struct PyTreeFileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t dim;
+    std::int32_t order;
+    std::int32_t scalingType;
+    std::int32_t rootScale;
+    std::int32_t nCoefs;
+    std::uint64_t nNodes;
+    std::uint64_t indexOffset;
+    std::uint64_t coefOffset;
+    // World box, unused dimensions are zero
+    std::int32_t corner[3];
+    std::int32_t nBoxes[3];
+    double scalingFactors[3];
+    std::int32_t periodic;
+};
+
+constexpr char tree_file_magic[8] = {'V', 'A', 'M', 'P', 'T', 'R', 'E', 'E'};
+constexpr std::uint32_t tree_file_version = 2;
+constexpr std::uint64_t tree_file_alignment = 4096;
+
+/** Writes the tree to file in the memory mappable container format */
+template <int D> void save_tree_file(FunctionTree<D, double> &tree, const std::string &filename) {
+    auto nodes = tree_nodes<D>(tree);
+    const auto &mra = tree.getMRA();
+
+    PyTreeFileHeader header{};
+    std::memcpy(header.magic, tree_file_magic, sizeof(header.magic));
+    header.version = tree_file_version;
+    header.dim = D;
+    header.order = mra.getOrder();
+    header.scalingType = mra.getScalingBasis().getScalingType();
+    header.rootScale = mra.getRootScale();
+    header.nCoefs = nodes[0]->getNCoefs();
+    header.nNodes = nodes.size();
+    const auto &box = mra.getWorldBox();
+    for (int d = 0; d < D; d++) {
+        header.corner[d] = box.getCornerIndex().getTranslation(d);
+        header.nBoxes[d] = box.size(d);
+        header.scalingFactors[d] = box.getScalingFactor(d);
+    }
+    header.periodic = box.isPeriodic();
+    header.indexOffset = sizeof(PyTreeFileHeader);
+    auto indexEnd = header.indexOffset + header.nNodes * (D + 1) * sizeof(std::int32_t);
+    header.coefOffset = ((indexEnd + tree_file_alignment - 1) / tree_file_alignment) * tree_file_alignment;
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (not out) throw std::runtime_error("Unable to open file: " + filename);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (auto *node : nodes) {
+        const NodeIndex<D> &idx = node->getNodeIndex();
+        std::int32_t row[D + 1];
+        row[0] = idx.getScale();
+        for (int d = 0; d < D; d++) row[d + 1] = idx.getTranslation(d);
+        out.write(reinterpret_cast<const char *>(row), sizeof(row));
+    }
+    std::vector<char> padding(header.coefOffset - indexEnd, 0);
+    out.write(padding.data(), padding.size());
+    std::vector<double> zero(header.nCoefs, 0.0);
+    for (auto *node : nodes) {
+        const double *coefs = node->hasCoefs() ? node->getCoefs() : zero.data();
+        out.write(reinterpret_cast<const char *>(coefs), header.nCoefs * sizeof(double));
+    }
+    if (not out) throw std::runtime_error("Unable to write file: " + filename);
+}
+
+/*
+ * Read-only memory mapping of a tree file. Construction only maps the file
+ * and validates its header, the index table and the coefficients are paged
+ * in by the OS on first access.
+ */
+template <int D> class PyTreeFile final {
+public:
+    explicit PyTreeFile(const std::string &filename)
+            : name(filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Unable to open file: " + filename);
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Unable to stat file: " + filename);
+        }
+        this->size = st.st_size;
+        if (this->size < sizeof(PyTreeFileHeader)) {
+            ::close(fd);
+            throw std::invalid_argument("Truncated tree file header: " + filename);
+        }
+        this->data = ::mmap(nullptr, this->size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (this->data == nullptr or this->data == MAP_FAILED) {
+            this->data = nullptr;
+            throw std::runtime_error("Unable to map file: " + filename);
+        }
+
+        auto error = validate();
+        if (not error.empty()) {
+            ::munmap(this->data, this->size);
+            this->data = nullptr;
+            throw std::invalid_argument(error + filename);
+        }
+    }
+
+    ~PyTreeFile() {
+        if (this->data != nullptr) ::munmap(this->data, this->size);
+    }
+
+    PyTreeFile(const PyTreeFile &) = delete;
+    PyTreeFile &operator=(const PyTreeFile &) = delete;
+
+    const PyTreeFileHeader &header() const { return *static_cast<const PyTreeFileHeader *>(this->data); }
+    const std::string &getName() const { return this->name; }
+    int getNNodes() const { return header().nNodes; }
+
+    const std::int32_t *getIndexTable() const { return reinterpret_cast<const std::int32_t *>(bytes() + header().indexOffset); }
+    const double *getCoefs() const { return reinterpret_cast<const double *>(bytes() + header().coefOffset); }
+
+    /*
+     * Rebuilds the output tree from the stored nodes up to maxScale that lie
+     * within the subtree of the given root index (whole tree if nullptr). The
+     * function is thus truncated to the resolution of maxScale and is zero
+     * outside of the subtree.
+     */
+    void load(FunctionTree<D, double> &tree, const NodeIndex<D> *root = nullptr, int maxScale = std::numeric_limits<int>::max()) const {
+        const auto &h = header();
+        const auto &mra = tree.getMRA();
+        if (mra.getOrder() != h.order or mra.getScalingBasis().getScalingType() != h.scalingType or mra.getRootScale() != h.rootScale) {
+            throw std::runtime_error("Tree file does not match the MRA of the tree: " + this->name);
+        }
+        if (not matchesWorld(mra.getWorldBox())) throw std::runtime_error("Tree file does not match the world box of the tree: " + this->name);
+
+        // The index table is stored as (scale, l_1, ..., l_D) rows
+        const std::int32_t *table = getIndexTable();
+        std::vector<int> scales(h.nNodes);
+        std::vector<int> translations(h.nNodes * D);
+        std::vector<int> rows;
+        for (int n = 0; n < h.nNodes; n++) {
+            const std::int32_t *row = table + n * (D + 1);
+            scales[n] = row[0];
+            for (int d = 0; d < D; d++) translations[n * D + d] = row[d + 1];
+            if (scales[n] > maxScale) continue;
+            if (root != nullptr and not isDescendant(*root, scales[n], row + 1)) continue;
+            rows.push_back(n);
+        }
+        read_tree_rows<D>(tree, rows, scales.data(), translations.data(), getCoefs());
+    }
+
+private:
+    std::string name;
+    std::size_t size{0};
+    void *data{nullptr};
+
+    const char *bytes() const { return static_cast<const char *>(this->data); }
+
+    // @returns An error message if the header does not describe a tree file of this size, otherwise empty
+    std::string validate() const {
+        const auto &h = header();
+        if (std::memcmp(h.magic, tree_file_magic, sizeof(h.magic)) != 0) return "Not a tree file: ";
+        if (h.version != tree_file_version) return "Unsupported tree file version: ";
+        if (h.dim != D) return "Tree file has wrong dimension: ";
+        if (h.nCoefs <= 0 or h.nNodes > static_cast<std::uint64_t>(std::numeric_limits<int>::max())) return "Corrupt tree file header: ";
+
+        // Sections must be aligned, in order, and within the file, sizes are compared by division to avoid overflow
+        std::uint64_t rowBytes = (D + 1) * sizeof(std::int32_t);
+        if (h.indexOffset < sizeof(PyTreeFileHeader) or h.indexOffset % alignof(std::int32_t) != 0 or h.indexOffset > this->size) {
+            return "Corrupt tree file index offset: ";
+        }
+        if (h.nNodes > (this->size - h.indexOffset) / rowBytes) return "Truncated tree file index table: ";
+        auto indexEnd = h.indexOffset + h.nNodes * rowBytes;
+        if (h.coefOffset < indexEnd or h.coefOffset % alignof(double) != 0 or h.coefOffset > this->size) return "Corrupt tree file coefficient offset: ";
+        if (h.nNodes > (this->size - h.coefOffset) / (h.nCoefs * sizeof(double))) return "Truncated tree file: ";
+        return "";
+    }
+
+    bool matchesWorld(const BoundingBox<D> &box) const {
+        const auto &h = header();
+        if (h.periodic != static_cast<std::int32_t>(box.isPeriodic())) return false;
+        for (int d = 0; d < D; d++) {
+            if (h.corner[d] != box.getCornerIndex().getTranslation(d) or h.nBoxes[d] != box.size(d)) return false;
+            if (h.scalingFactors[d] != box.getScalingFactor(d)) return false;
+        }
+        return true;
+    }
+
+    static bool isDescendant(const NodeIndex<D> &root, int scale, const std::int32_t *l) {
+        int shift = scale - root.getScale();
+        if (shift < 0) return false;
+        for (int d = 0; d < D; d++) {
+            if ((l[d] >> shift) != root.getTranslation(d)) return false;
+        }
+        return true;
+    }
+};
+
+} // namespace mrcpp
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+#include <MRCPP/trees/FunctionTree.h>
+#include <MRCPP/trees/NodeAllocator.h>
+
+namespace mrcpp {
+
+/*
+ * Memory held by a tree in its node allocators. MRCPP allocates nodes and
+ * their coefficients in fixed-size chunks, which are kept when nodes are
+ * deleted, so the allocated size may be well above what the current nodes
+ * need. The GenNodes created when the tree is read are held in a separate
+ * allocator, whose chunks also stay allocated after deleteGenerated().
+ */
+struct PyTreeMemory {
+    long nodeBytes{0}; // node chunks of the tree
+    long coefBytes{0}; // coefficient chunks of the tree
+    long genBytes{0};  // node and coefficient chunks of the GenNodes
+    long usedBytes{0}; // part of all chunks occupied by existing nodes
+    int nChunks{0};    // allocated chunks, including GenNode chunks
+
+    long allocated() const { return this->nodeBytes + this->coefBytes + this->genBytes; }
+    long unused() const { return allocated() - this->usedBytes; }
+};
+
+template <int D> void add_allocator_memory(PyTreeMemory &mem, NodeAllocator<D, double> &allocator, bool gen) {
+    long nodeChunk = allocator.getNodeChunkSize();
+    long coefChunk = allocator.getCoefChunkSize();
+    long nodesPerChunk = coefChunk / (allocator.getNCoefs() * sizeof(double));
+    long nChunks = allocator.getNChunks();
+    if (gen) {
+        mem.genBytes += nChunks * (nodeChunk + coefChunk);
+    } else {
+        mem.nodeBytes += nChunks * nodeChunk;
+        mem.coefBytes += nChunks * coefChunk;
+    }
+    if (nodesPerChunk > 0) mem.usedBytes += allocator.getNNodes() * (nodeChunk + coefChunk) / nodesPerChunk;
+    mem.nChunks += nChunks;
+}
+
+/** @returns The memory held by the node and GenNode allocators of the tree */
+template <int D> PyTreeMemory tree_memory(FunctionTree<D, double> &tree) {
+    PyTreeMemory mem;
+    add_allocator_memory<D>(mem, tree.getNodeAllocator(), false);
+    add_allocator_memory<D>(mem, tree.getGenNodeAllocator(), true);
+    return mem;
+}
+
+/*
+ * Running total of the memory held by the trees owned by Python.
+ *
+ * Trees are added when created by make_tree() and removed by their deleter,
+ * and the bytes of a tree are refreshed at the end of every bound operation
+ * that outputs it, while the operation still holds its lock. The total is
+ * thus read without touching any tree or the GIL. Growth of a tree outside
+ * of the bound operations is only seen at its next operation.
+ */
+class PyTreeCounter final {
+public:
+    static PyTreeCounter &get() {
+        static auto *counter = new PyTreeCounter();
+        return *counter;
+    }
+
+    void add(const void *tree, long bytes) {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        if (this->charged.emplace(tree, bytes).second) this->total += bytes;
+    }
+
+    /** Refreshes the bytes of a counted tree, other trees are ignored */
+    void update(const void *tree, long bytes) {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        auto it = this->charged.find(tree);
+        if (it == this->charged.end()) return;
+        this->total += bytes - it->second;
+        it->second = bytes;
+    }
+
+    void remove(const void *tree) {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        auto it = this->charged.find(tree);
+        if (it == this->charged.end()) return;
+        this->total -= it->second;
+        this->charged.erase(it);
+    }
+
+    long getBytes() const { return this->total.load(std::memory_order_relaxed); }
+
+    /** @returns The bytes counted for a tree, zero for trees not counted */
+    long getBytes(const void *tree) const {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        auto it = this->charged.find(tree);
+        return (it != this->charged.end()) ? it->second : 0;
+    }
+
+    int getNTrees() const {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        return this->charged.size();
+    }
+
+private:
+    PyTreeCounter() = default;
+
+    mutable std::mutex mutex;
+    std::unordered_map<const void *, long> charged;
+    std::atomic<long> total{0};
+};
+
+} // namespace mrcpp
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <MRCPP/trees/FunctionTree.h>
+#include <MRCPP/trees/MultiResolutionAnalysis.h>
+
+#include "PyTreeMemory.h"
+
+namespace mrcpp {
+
+/*
+ * Opt-in pool of released function trees, reused by later operations.
+ *
+ * MRCPP trees allocate their nodes in large chunks, which are freed with the
+ * tree, so loops that create and drop temporary trees spend much of their
+ * time allocating and page faulting fresh chunks. With the pool enabled,
+ * trees released by Python or by the bindings are cleared, which keeps their
+ * chunks, and handed out again by make_tree() for the same MRA. At most
+ * capacity trees are kept per MRA, and trim() frees all of them.
+ */
+template <int D> class PyTreePool final {
+public:
+    static PyTreePool<D> &get() {
+        static auto *pool = new PyTreePool<D>();
+        return *pool;
+    }
+
+    int getCapacity() const { return this->capacity.load(std::memory_order_relaxed); }
+
+    void setCapacity(int n) {
+        this->capacity.store(std::max(n, 0));
+        std::vector<FunctionTree<D, double> *> excess;
+        {
+            std::lock_guard<std::mutex> guard(this->mutex);
+            for (auto &bucket : this->buckets) {
+                while (bucket.second.size() > static_cast<size_t>(getCapacity())) {
+                    excess.push_back(bucket.second.back());
+                    bucket.second.pop_back();
+                }
+            }
+        }
+        for (auto *tree : excess) delete tree;
+    }
+
+    /** @returns A cleared tree of the given MRA, or nullptr if there is none */
+    FunctionTree<D, double> *acquire(const MultiResolutionAnalysis<D> &mra) {
+        if (getCapacity() == 0) return nullptr;
+        std::lock_guard<std::mutex> guard(this->mutex);
+        auto *bucket = find(mra);
+        if (bucket == nullptr or bucket->empty()) return nullptr;
+        auto *tree = bucket->back();
+        bucket->pop_back();
+        return tree;
+    }
+
+    /** @returns True if the tree was taken by the pool, otherwise it must be deleted by the caller */
+    bool release(FunctionTree<D, double> *tree) {
+        if (tree == nullptr or not hasRoom(tree->getMRA())) return false;
+        // Clearing deletes all nodes but the roots, the chunks are kept
+        tree->deleteGenerated();
+        tree->clear();
+        std::lock_guard<std::mutex> guard(this->mutex);
+        auto *bucket = find(tree->getMRA());
+        if (bucket == nullptr) {
+            this->buckets.emplace_back(tree->getMRA(), std::vector<FunctionTree<D, double> *>());
+            bucket = &this->buckets.back().second;
+        }
+        if (bucket->size() >= static_cast<size_t>(getCapacity())) return false;
+        bucket->push_back(tree);
+        return true;
+    }
+
+    void trim() {
+        std::vector<std::pair<MultiResolutionAnalysis<D>, std::vector<FunctionTree<D, double> *>>> trees;
+        {
+            std::lock_guard<std::mutex> guard(this->mutex);
+            std::swap(trees, this->buckets);
+        }
+        for (auto &bucket : trees) {
+            for (auto *tree : bucket.second) delete tree;
+        }
+    }
+
+    /** @returns The number of pooled trees and the memory they hold */
+    std::pair<int, long> size() {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        int nTrees = 0;
+        long bytes = 0;
+        for (auto &bucket : this->buckets) {
+            for (auto *tree : bucket.second) bytes += tree_memory<D>(*tree).allocated();
+            nTrees += bucket.second.size();
+        }
+        return {nTrees, bytes};
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::atomic<int> capacity{0};
+    std::vector<std::pair<MultiResolutionAnalysis<D>, std::vector<FunctionTree<D, double> *>>> buckets;
+
+    PyTreePool() = default;
+
+    std::vector<FunctionTree<D, double> *> *find(const MultiResolutionAnalysis<D> &mra) {
+        for (auto &bucket : this->buckets) {
+            if (bucket.first == mra) return &bucket.second;
+        }
+        return nullptr;
+    }
+
+    bool hasRoom(const MultiResolutionAnalysis<D> &mra) {
+        if (getCapacity() == 0) return false;
+        std::lock_guard<std::mutex> guard(this->mutex);
+        auto *bucket = find(mra);
+        return bucket == nullptr or bucket->size() < static_cast<size_t>(getCapacity());
+    }
+};
+
+// Deleter returning trees to the pool when it has room
+template <int D> struct PyTreeDeleter {
+    void operator()(FunctionTree<D, double> *tree) const {
+        PyTreeCounter::get().remove(tree);
+        if (not PyTreePool<D>::get().release(tree)) delete tree;
+    }
+};
+
+/*
+ * Owning pointer to a function tree. All trees handed to Python are held by
+ * such pointers, so trees dropped by Python go back to the pool.
+ */
+template <int D> using PyTreePtr = std::unique_ptr<FunctionTree<D, double>, PyTreeDeleter<D>>;
+
+/** @returns Owning pointer to a tree allocated by MRCPP, counted in the tree memory */
+template <int D> PyTreePtr<D> adopt_tree(FunctionTree<D, double> *tree) {
+    PyTreeCounter::get().add(tree, tree_memory<D>(*tree).allocated());
+    return PyTreePtr<D>(tree);
+}
+
+/** @returns A new tree, taken from the pool if possible */
+template <int D> PyTreePtr<D> make_tree(const MultiResolutionAnalysis<D> &mra, const std::string &name = "nn") {
+    auto *tree = PyTreePool<D>::get().acquire(mra);
+    if (tree == nullptr) return adopt_tree<D>(new FunctionTree<D, double>(mra, name));
+    tree->setName(name);
+    return adopt_tree<D>(tree);
+}
+
+} // namespace mrcpp
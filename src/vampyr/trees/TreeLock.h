@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace vampyr {
+
+/*
+ * Serializes bound operations that touch the same trees or operators.
+ *
+ * MRCPP trees are not safe for concurrent use, not even as inputs: reading
+ * a tree may create (and later delete) GenNodes, and applying an operator
+ * updates its cached band widths. Every binding that releases the GIL
+ * therefore holds a TreeLock on all trees and operators it touches for the
+ * duration of the call. Operations on disjoint objects run concurrently,
+ * while operations sharing an object are executed one after the other.
+ *
+ * Objects are locked individually, and a TreeLock waits until all of its
+ * objects are free before taking any of them, so two operations never wait
+ * on each other while holding part of their objects. The locks are owned by
+ * a thread and re-entrant: a Python callback run by a locked operation, e.g.
+ * a vectorized function being projected, may use the same objects again on
+ * that thread. Such callbacks should not wait on other threads that use
+ * these objects.
+ */
+class TreeLock final {
+public:
+    template <typename... Objs> explicit TreeLock(const Objs &...objs) {
+        (collect(objs), ...);
+        std::sort(this->objects.begin(), this->objects.end());
+        this->objects.erase(std::unique(this->objects.begin(), this->objects.end()), this->objects.end());
+        if (this->objects.empty()) return;
+
+        auto &reg = registry();
+        auto self = std::this_thread::get_id();
+        std::unique_lock<std::mutex> guard(reg.mutex);
+        reg.released.wait(guard, [&]() {
+            return std::all_of(this->objects.begin(), this->objects.end(), [&](const void *obj) {
+                auto it = reg.owners.find(obj);
+                return it == reg.owners.end() or it->second.thread == self;
+            });
+        });
+        for (auto *obj : this->objects) {
+            auto &owner = reg.owners[obj];
+            owner.thread = self;
+            owner.count++;
+        }
+    }
+
+    ~TreeLock() {
+        if (this->objects.empty()) return;
+        auto &reg = registry();
+        {
+            std::lock_guard<std::mutex> guard(reg.mutex);
+            for (auto *obj : this->objects) {
+                auto it = reg.owners.find(obj);
+                if (--it->second.count == 0) reg.owners.erase(it);
+            }
+        }
+        reg.released.notify_all();
+    }
+
+    TreeLock(const TreeLock &) = delete;
+    TreeLock &operator=(const TreeLock &) = delete;
+
+private:
+    // Thread holding an object, and the number of its TreeLocks on it
+    struct Owner {
+        std::thread::id thread;
+        int count{0};
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::condition_variable released;
+        std::unordered_map<const void *, Owner> owners;
+    };
+
+    std::vector<const void *> objects;
+
+    static Registry &registry() {
+        static Registry reg;
+        return reg;
+    }
+
+    template <typename T> void collect(T *obj) {
+        if (obj == nullptr) return;
+        this->objects.push_back(static_cast<const void *>(obj));
+    }
+
+    // Lists are locked by their elements, not by the address of the list
+    template <typename T> void collect(std::vector<T> *objs) = delete;
+    template <typename T> void collect(const std::vector<T> *objs) = delete;
+
+    template <typename T> void collect(const std::vector<T *> &objs) {
+        for (auto *obj : objs) collect(obj);
+    }
+
+    template <typename C, typename T> void collect(const std::vector<std::tuple<C, T *>> &objs) {
+        for (auto &t : objs) collect(std::get<1>(t));
+    }
+};
+
+} // namespace vampyr
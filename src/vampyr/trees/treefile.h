@@ -0,0 +1,80 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+#include <pybind11/stl/filesystem.h>
+
+#include "PyTreeFile.h"
+#include "TreeLock.h"
+#include "core/Profiler.h"
+
+namespace vampyr {
+
+template <int D> void treefile(pybind11::module &m) {
+    using namespace mrcpp;
+    namespace py = pybind11;
+    using namespace pybind11::literals;
+
+    py::class_<PyTreeFile<D>>(m, "TreeFile", R"mydelimiter(
+        Memory mapped binary tree file.
+
+        The file holds a node index table followed by a contiguous section
+        with the MW coefficients of all nodes. Opening a file only maps it
+        into memory, coefficients are read from disk on first access, so
+        loading a subtree or a coarse version of the tree only reads the
+        selected nodes.
+    )mydelimiter")
+        .def(py::init<const std::string &>(), "filename"_a, py::call_guard<py::gil_scoped_release>())
+        .def_static(
+            "write",
+            [](FunctionTree<D, double> &tree, const std::string &filename) {
+                namespace fs = std::filesystem;
+                TreeLock lock(&tree);
+                ProfileScope prof("TreeFile.write", &tree);
+                save_tree_file<D>(tree, filename);
+                return fs::absolute(fs::path(filename));
+            },
+            "tree"_a,
+            "filename"_a,
+            py::call_guard<py::gil_scoped_release>(),
+            "Write the tree to a new tree file, returns the absolute path of the file.")
+        .def("name", &PyTreeFile<D>::getName)
+        .def("nNodes", &PyTreeFile<D>::getNNodes)
+        .def("version", [](const PyTreeFile<D> &file) { return file.header().version; })
+        .def("order", [](const PyTreeFile<D> &file) { return file.header().order; })
+        .def(
+            "indexTable",
+            [](py::object self) {
+                auto &file = self.cast<const PyTreeFile<D> &>();
+                auto nNodes = static_cast<py::ssize_t>(file.getNNodes());
+                py::array_t<std::int32_t> table({nNodes, static_cast<py::ssize_t>(D + 1)}, file.getIndexTable(), self);
+                table.attr("setflags")("write"_a = false);
+                return table;
+            },
+            "Read-only (nNodes, D + 1) view of the node table, with rows (scale, translation).")
+        .def(
+            "load",
+            [](const PyTreeFile<D> &file, FunctionTree<D, double> &tree, std::optional<NodeIndex<D>> root, std::optional<int> max_scale) {
+                TreeLock lock(&tree);
+                ProfileScope prof("TreeFile.load");
+                prof.output(&tree);
+                file.load(tree, root ? &(*root) : nullptr, max_scale.value_or(std::numeric_limits<int>::max()));
+            },
+            "tree"_a,
+            "root"_a = py::none(),
+            "max_scale"_a = py::none(),
+            py::call_guard<py::gil_scoped_release>(),
+            R"mydelimiter(
+            Load the stored function into tree, replacing its grid.
+
+            With root given, only the nodes of the subtree below this node index
+            are loaded, and the function is zero elsewhere. With max_scale given,
+            nodes at finer scales are skipped and the function is truncated to
+            this resolution.
+            )mydelimiter");
+}
+
+} // namespace vampyr
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <filesystem>
+#include <functional>
 
 #include <pybind11/eigen.h>
+#include <pybind11/numpy.h>
 #include <pybind11/stl/filesystem.h>
 
 #include <MRCPP/trees/FunctionNode.h>
@@ -10,13 +13,23 @@
 #include <MRCPP/trees/MWNode.h>
 #include <MRCPP/trees/MWTree.h>
 #include <MRCPP/trees/TreeIterator.h>
+#include <MRCPP/utils/periodic_utils.h>
+
+#include "PyTreeArrays.h"
+#include "PyTreeMemory.h"
+#include "PyTreePool.h"
+#include "TreeLock.h"
+#include "core/Profiler.h"
 
 namespace vampyr {
 template <int D>
 auto impl__add__(mrcpp::FunctionTree<D, double> *inp_a, mrcpp::FunctionTree<D, double> *inp_b)
-    -> std::unique_ptr<mrcpp::FunctionTree<D, double>> {
+    -> mrcpp::PyTreePtr<D> {
     using namespace mrcpp;
-    auto out = std::make_unique<FunctionTree<D, double>>(inp_a->getMRA());
+    TreeLock lock(inp_a, inp_b);
+    ProfileScope prof("FunctionTree.__add__", inp_a, inp_b);
+    auto out = make_tree<D>(inp_a->getMRA());
+    prof.output(out);
     FunctionTreeVector<D, double> vec;
     vec.push_back({1.0, inp_a});
     vec.push_back({1.0, inp_b});
@@ -27,9 +40,12 @@ auto impl__add__(mrcpp::FunctionTree<D, double> *inp_a, mrcpp::FunctionTree<D, d
 
 template <int D>
 auto impl__sub__(mrcpp::FunctionTree<D, double> *inp_a, mrcpp::FunctionTree<D, double> *inp_b)
-    -> std::unique_ptr<mrcpp::FunctionTree<D, double>> {
+    -> mrcpp::PyTreePtr<D> {
     using namespace mrcpp;
-    auto out = std::make_unique<FunctionTree<D, double>>(inp_a->getMRA());
+    TreeLock lock(inp_a, inp_b);
+    ProfileScope prof("FunctionTree.__sub__", inp_a, inp_b);
+    auto out = make_tree<D>(inp_a->getMRA());
+    prof.output(out);
     FunctionTreeVector<D, double> vec;
     vec.push_back({1.0, inp_a});
     vec.push_back({-1.0, inp_b});
@@ -40,9 +56,12 @@ auto impl__sub__(mrcpp::FunctionTree<D, double> *inp_a, mrcpp::FunctionTree<D, d
 
 template <int D>
 auto impl__mul__(mrcpp::FunctionTree<D, double> *inp_a, mrcpp::FunctionTree<D, double> *inp_b)
-    -> std::unique_ptr<mrcpp::FunctionTree<D, double>> {
+    -> mrcpp::PyTreePtr<D> {
     using namespace mrcpp;
-    auto out = std::make_unique<FunctionTree<D, double>>(inp_a->getMRA());
+    TreeLock lock(inp_a, inp_b);
+    ProfileScope prof("FunctionTree.__mul__", inp_a, inp_b);
+    auto out = make_tree<D>(inp_a->getMRA());
+    prof.output(out);
     FunctionTreeVector<D, double> vec;
     vec.push_back({1.0, inp_a});
     vec.push_back({1.0, inp_b});
@@ -53,9 +72,12 @@ auto impl__mul__(mrcpp::FunctionTree<D, double> *inp_a, mrcpp::FunctionTree<D, d
 };
 
 template <int D>
-auto impl__mul__(mrcpp::FunctionTree<D, double> *inp_a, double c) -> std::unique_ptr<mrcpp::FunctionTree<D, double>> {
+auto impl__mul__(mrcpp::FunctionTree<D, double> *inp_a, double c) -> mrcpp::PyTreePtr<D> {
     using namespace mrcpp;
-    auto out = std::make_unique<FunctionTree<D, double>>(inp_a->getMRA());
+    TreeLock lock(inp_a);
+    ProfileScope prof("FunctionTree.__mul__", inp_a);
+    auto out = make_tree<D>(inp_a->getMRA());
+    prof.output(out);
     FunctionTreeVector<D, double> vec;
     vec.push_back({c, inp_a});
     build_grid(*out, vec);
@@ -63,17 +85,23 @@ auto impl__mul__(mrcpp::FunctionTree<D, double> *inp_a, double c) -> std::unique
     return out;
 };
 
-template <int D> auto impl__pos__(mrcpp::FunctionTree<D, double> *inp) -> std::unique_ptr<mrcpp::FunctionTree<D, double>> {
+template <int D> auto impl__pos__(mrcpp::FunctionTree<D, double> *inp) -> mrcpp::PyTreePtr<D> {
     using namespace mrcpp;
-    auto out = std::make_unique<FunctionTree<D, double>>(inp->getMRA());
+    TreeLock lock(inp);
+    ProfileScope prof("FunctionTree.__pos__", inp);
+    auto out = make_tree<D>(inp->getMRA());
+    prof.output(out);
     copy_grid(*out, *inp);
     copy_func(*out, *inp);
     return out;
 };
 
-template <int D> auto impl__neg__(mrcpp::FunctionTree<D, double> *inp) -> std::unique_ptr<mrcpp::FunctionTree<D, double>> {
+template <int D> auto impl__neg__(mrcpp::FunctionTree<D, double> *inp) -> mrcpp::PyTreePtr<D> {
     using namespace mrcpp;
-    auto out = std::make_unique<FunctionTree<D, double>>(inp->getMRA());
+    TreeLock lock(inp);
+    ProfileScope prof("FunctionTree.__neg__", inp);
+    auto out = make_tree<D>(inp->getMRA());
+    prof.output(out);
     FunctionTreeVector<D, double> vec;
     vec.push_back({-1.0, inp});
     build_grid(*out, vec);
@@ -82,9 +110,12 @@ template <int D> auto impl__neg__(mrcpp::FunctionTree<D, double> *inp) -> std::u
 };
 
 template <int D>
-auto impl__truediv__(mrcpp::FunctionTree<D, double> *inp, double c) -> std::unique_ptr<mrcpp::FunctionTree<D, double>> {
+auto impl__truediv__(mrcpp::FunctionTree<D, double> *inp, double c) -> mrcpp::PyTreePtr<D> {
     using namespace mrcpp;
-    auto out = std::make_unique<FunctionTree<D, double>>(inp->getMRA());
+    TreeLock lock(inp);
+    ProfileScope prof("FunctionTree.__truediv__", inp);
+    auto out = make_tree<D>(inp->getMRA());
+    prof.output(out);
     FunctionTreeVector<D, double> vec;
     vec.push_back({1.0 / c, inp});
     build_grid(*out, vec);
@@ -92,9 +123,12 @@ auto impl__truediv__(mrcpp::FunctionTree<D, double> *inp, double c) -> std::uniq
     return out;
 };
 
-template <int D> auto impl__pow__(mrcpp::FunctionTree<D, double> *inp, double c) -> std::unique_ptr<mrcpp::FunctionTree<D, double>> {
+template <int D> auto impl__pow__(mrcpp::FunctionTree<D, double> *inp, double c) -> mrcpp::PyTreePtr<D> {
     using namespace mrcpp;
-    auto out = std::make_unique<FunctionTree<D, double>>(inp->getMRA());
+    TreeLock lock(inp);
+    ProfileScope prof("FunctionTree.__pow__", inp);
+    auto out = make_tree<D>(inp->getMRA());
+    prof.output(out);
     copy_grid(*out, *inp);
     copy_func(*out, *inp);
     refine_grid(*out, 1);
@@ -102,6 +136,204 @@ template <int D> auto impl__pow__(mrcpp::FunctionTree<D, double> *inp, double c)
     return out;
 };
 
+/*
+ * The in-place operators accumulate into the existing nodes of the left
+ * operand. Its grid is only refined where the right operand is finer (and one
+ * extra level for products), with coefficients passed down to the new nodes.
+ * refine_grid adds one level per call, so it is repeated until the grid covers
+ * the right operand.
+ */
+template <int D>
+auto impl__iadd__(mrcpp::FunctionTree<D, double> *out, mrcpp::FunctionTree<D, double> *inp) -> mrcpp::FunctionTree<D, double> * {
+    using namespace mrcpp;
+    TreeLock lock(out, inp);
+    ProfileScope prof("FunctionTree.__iadd__", out, inp);
+    prof.output(out);
+    if (out == inp) {
+        out->rescale(2.0);
+    } else {
+        while (refine_grid(*out, *inp) > 0) {}
+        out->add(1.0, *inp);
+    }
+    return out;
+};
+
+template <int D>
+auto impl__isub__(mrcpp::FunctionTree<D, double> *out, mrcpp::FunctionTree<D, double> *inp) -> mrcpp::FunctionTree<D, double> * {
+    using namespace mrcpp;
+    TreeLock lock(out, inp);
+    ProfileScope prof("FunctionTree.__isub__", out, inp);
+    prof.output(out);
+    if (out == inp) {
+        out->setZero();
+    } else {
+        while (refine_grid(*out, *inp) > 0) {}
+        out->add(-1.0, *inp);
+    }
+    return out;
+};
+
+template <int D>
+auto impl__imul__(mrcpp::FunctionTree<D, double> *out, mrcpp::FunctionTree<D, double> *inp) -> mrcpp::FunctionTree<D, double> * {
+    using namespace mrcpp;
+    TreeLock lock(out, inp);
+    ProfileScope prof("FunctionTree.__imul__", out, inp);
+    prof.output(out);
+    if (out == inp) {
+        refine_grid(*out, 1);
+        out->square();
+    } else {
+        while (refine_grid(*out, *inp) > 0) {}
+        refine_grid(*out, 1);
+        out->multiply(1.0, *inp);
+    }
+    return out;
+};
+
+template <int D> auto impl__imul__(mrcpp::FunctionTree<D, double> *out, double c) -> mrcpp::FunctionTree<D, double> * {
+    using namespace mrcpp;
+    TreeLock lock(out);
+    ProfileScope prof("FunctionTree.__imul__", out);
+    prof.output(out);
+    out->rescale(c);
+    return out;
+};
+
+template <int D> auto impl__itruediv__(mrcpp::FunctionTree<D, double> *out, double c) -> mrcpp::FunctionTree<D, double> * {
+    using namespace mrcpp;
+    TreeLock lock(out);
+    ProfileScope prof("FunctionTree.__itruediv__", out);
+    prof.output(out);
+    out->rescale(1.0 / c);
+    return out;
+};
+
+template <int D> auto impl__ipow__(mrcpp::FunctionTree<D, double> *out, double c) -> mrcpp::FunctionTree<D, double> * {
+    using namespace mrcpp;
+    TreeLock lock(out);
+    ProfileScope prof("FunctionTree.__ipow__", out);
+    prof.output(out);
+    refine_grid(*out, 1);
+    out->power(c);
+    return out;
+};
+
+/*
+ * Evaluates the tree in nPts points, given as a flat row-major (nPts, D) array.
+ *
+ * In precise mode the points are sorted by the end node they fall in, and each
+ * node reconstructs its child scaling coefficients once for all its points,
+ * equivalent to calling evalf_precise on every point. In fast mode every point
+ * is evaluated with evalf, i.e. using the scaling part of its end node only.
+ */
+template <int D>
+void impl__evaluate__(mrcpp::FunctionTree<D, double> &tree, const double *pts, double *vals, int nPts, bool fast) {
+    using namespace mrcpp;
+    if (fast) {
+#pragma omp parallel for schedule(static) num_threads(mrcpp_get_num_threads())
+        for (int i = 0; i < nPts; i++) {
+            Coord<D> r;
+            for (int d = 0; d < D; d++) r[d] = pts[i * D + d];
+            vals[i] = tree.evalf(r);
+        }
+        return;
+    }
+
+    const auto &box = tree.getMRA().getWorldBox();
+    const auto sfac = box.getScalingFactors();
+    const auto lb = box.getLowerBounds();
+    const auto ub = box.getUpperBounds();
+    const auto periodic = box.isPeriodic();
+
+    // Adjust for scaling factor included in basis
+    auto coef = 1.0;
+    for (int d = 0; d < D; d++) coef /= std::sqrt(sfac[d]);
+
+    // Locate the end node of each point, points outside the domain stay at nullptr
+    std::vector<Coord<D>> args(nPts);
+    std::vector<MWNode<D, double> *> nodes(nPts, nullptr);
+#pragma omp parallel for schedule(static) num_threads(mrcpp_get_num_threads())
+    for (int i = 0; i < nPts; i++) {
+        bool inside = true;
+        for (int d = 0; d < D; d++) {
+            auto x = pts[i * D + d];
+            if (not periodic and (x < lb[d] or x >= ub[d])) inside = false;
+            args[i][d] = x / sfac[d];
+        }
+        // Periodic points are wrapped into the world box, as in evalf_precise
+        if (periodic) periodic::coord_manipulation<D>(args[i], box.getPeriodic());
+        vals[i] = 0.0;
+        if (inside) nodes[i] = &tree.getNodeOrEndNode(args[i]);
+    }
+
+    // Group the points by node
+    std::vector<int> order;
+    order.reserve(nPts);
+    for (int i = 0; i < nPts; i++) if (nodes[i] != nullptr) order.push_back(i);
+    std::sort(order.begin(), order.end(), [&nodes](int a, int b) { return std::less<>()(nodes[a], nodes[b]); });
+
+    std::vector<int> first;
+    for (int j = 0; j < static_cast<int>(order.size()); j++) {
+        if (j == 0 or nodes[order[j]] != nodes[order[j - 1]]) first.push_back(j);
+    }
+    int nGroups = first.size();
+    first.push_back(order.size());
+
+#pragma omp parallel for schedule(dynamic) num_threads(mrcpp_get_num_threads())
+    for (int g = 0; g < nGroups; g++) {
+        auto &node = static_cast<FunctionNode<D, double> &>(*nodes[order[first[g]]]);
+        for (int j = first[g]; j < first[g + 1]; j++) {
+            int i = order[j];
+            vals[i] = coef * node.evalf(args[i]);
+        }
+    }
+    tree.deleteGenerated();
+}
+
+template <int D> pybind11::tuple impl__toArrays__(mrcpp::FunctionTree<D, double> &tree) {
+    using namespace mrcpp;
+    namespace py = pybind11;
+    py::array_t<int> scales, translations;
+    py::array_t<double> coefs;
+    {
+        py::gil_scoped_release release;
+        TreeLock lock(&tree);
+        auto nodes = tree_nodes<D>(tree);
+        auto nNodes = static_cast<py::ssize_t>(nodes.size());
+        auto nCoefs = static_cast<py::ssize_t>(nodes[0]->getNCoefs());
+        {
+            py::gil_scoped_acquire acquire;
+            scales = py::array_t<int>(nNodes);
+            translations = py::array_t<int>({nNodes, static_cast<py::ssize_t>(D)});
+            coefs = py::array_t<double>({nNodes, nCoefs});
+        }
+        write_tree_arrays<D>(nodes, scales.mutable_data(), translations.mutable_data(), coefs.mutable_data());
+    }
+    return py::make_tuple(scales, translations, coefs);
+}
+
+template <int D>
+void impl__fromArrays__(mrcpp::FunctionTree<D, double> &tree,
+                        pybind11::array_t<int, pybind11::array::c_style | pybind11::array::forcecast> scales,
+                        pybind11::array_t<int, pybind11::array::c_style | pybind11::array::forcecast> translations,
+                        pybind11::array_t<double, pybind11::array::c_style | pybind11::array::forcecast> coefs) {
+    using namespace mrcpp;
+    namespace py = pybind11;
+    auto nNodes = scales.size();
+    bool flat = (D == 1 and translations.ndim() == 1);
+    if (scales.ndim() != 1 or translations.shape(0) != nNodes or (not flat and translations.size() != nNodes * D)) {
+        throw py::value_error("Expected scales of shape (N,) and translations of shape (N, D)");
+    }
+    if (coefs.ndim() != 2 or coefs.shape(0) != nNodes or coefs.shape(1) != tree.getTDim() * tree.getKp1_d()) {
+        throw py::value_error("Expected coefs of shape (N, nCoefs)");
+    }
+    py::gil_scoped_release release;
+    TreeLock lock(&tree);
+    ProfileScope prof("FunctionTree.fromArrays");
+    prof.output(&tree);
+    read_tree_arrays<D>(tree, nNodes, scales.data(), translations.data(), coefs.data());
+}
+
 template <int D> void trees(pybind11::module &m) {
     using namespace mrcpp;
     namespace py = pybind11;
@@ -112,26 +344,66 @@ template <int D> void trees(pybind11::module &m) {
         .def("nNodes", &MWTree<D, double>::getNNodes)
         .def("nEndNodes", &MWTree<D, double>::getNEndNodes)
         .def("nRootNodes", &MWTree<D, double>::getNRootNodes)
-        .def("fetchEndNode",
-             [](MWTree<D, double>& tree, int i) -> MWNode<D, double>& { return tree.getEndMWNode(i); },
-             py::return_value_policy::reference_internal)
-        .def("fetchRootNode",
-             [](MWTree<D, double>& tree, int i) -> MWNode<D, double>& { return tree.getRootMWNode(i); },
-             py::return_value_policy::reference_internal)
+        .def(
+            "fetchEndNode",
+            [](MWTree<D, double> &tree, int i) -> MWNode<D, double> & {
+                TreeLock lock(&tree);
+                return tree.getEndMWNode(i);
+            },
+            py::return_value_policy::reference_internal,
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "fetchRootNode",
+            [](MWTree<D, double> &tree, int i) -> MWNode<D, double> & {
+                TreeLock lock(&tree);
+                return tree.getRootMWNode(i);
+            },
+            py::return_value_policy::reference_internal,
+            py::call_guard<py::gil_scoped_release>())
         .def("rootScale", &MWTree<D, double>::getRootScale)
         .def("depth", &MWTree<D, double>::getDepth)
-        .def("setZero",
-             [](MWTree<D, double> *out) {
-                 out->setZero();
-                 return out;
-             })
-        .def("clear", &MWTree<D, double>::clear)
+        .def(
+            "setZero",
+            [](MWTree<D, double> *out) {
+                TreeLock lock(out);
+                out->setZero();
+                return out;
+            },
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "clear",
+            [](MWTree<D, double> &out) {
+                TreeLock lock(&out);
+                out.clear();
+            },
+            py::call_guard<py::gil_scoped_release>())
         .def("setName", &MWTree<D, double>::setName)
         .def("name", &MWTree<D, double>::getName)
-        .def("fetchNode",
-             [](MWTree<D, double>& tree, NodeIndex<D> idx) -> MWNode<D, double>& { return tree.getNode(idx); },
-             py::return_value_policy::reference_internal)
+        .def(
+            "fetchNode",
+            [](MWTree<D, double> &tree, NodeIndex<D> idx) -> MWNode<D, double> & {
+                TreeLock lock(&tree);
+                return tree.getNode(idx);
+            },
+            py::return_value_policy::reference_internal,
+            py::call_guard<py::gil_scoped_release>())
         .def("squaredNorm", &MWTree<D, double>::getSquareNorm)
+        .def(
+            "calcSquareNorm",
+            [](MWTree<D, double> &tree) {
+                TreeLock lock(&tree);
+                tree.calcSquareNorm();
+                return tree.getSquareNorm();
+            },
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "mwTransform",
+            [](MWTree<D, double> &tree, Traverse type) {
+                TreeLock lock(&tree);
+                tree.mwTransform(type);
+            },
+            "type"_a,
+            py::call_guard<py::gil_scoped_release>())
         .def("norm",
              [](MWTree<D, double> &tree) {
                  auto sqNorm = tree.getSquareNorm();
@@ -143,58 +415,257 @@ template <int D> void trees(pybind11::module &m) {
             return os.str();
         });
 
-    py::class_<FunctionTree<D, double>, MWTree<D, double>, RepresentableFunction<D, double>>(m, "FunctionTree")
-        .def(py::init<const MultiResolutionAnalysis<D> &, const std::string &>(), "mra"_a, "name"_a = "nn")
+    py::class_<FunctionTree<D, double>, PyTreePtr<D>, MWTree<D, double>, RepresentableFunction<D, double>>(m,
+                                                                                                 "FunctionTree",
+                                                                                                 R"mydelimiter(
+        Multiwavelet representation of a function.
+
+        Compute-heavy methods and operations taking trees as arguments release
+        the GIL, so independent trees can be processed concurrently from
+        several Python threads. A tree must not be shared between concurrent
+        operations, not even as a read-only input, since MRCPP may create and
+        delete nodes on its inputs. VAMPyR therefore serializes operations
+        that touch the same tree or operator, while operations on disjoint
+        objects run in parallel.
+    )mydelimiter")
+        .def(py::init([](const MultiResolutionAnalysis<D> &mra, const std::string &name) { return make_tree<D>(mra, name); }),
+             "mra"_a,
+             "name"_a = "nn")
         .def("nGenNodes", &FunctionTree<D, double>::getNGenNodes)
-        .def("deleteGenerated", &FunctionTree<D, double>::deleteGenerated)
-        .def("integrate", &FunctionTree<D, double>::integrate)
-        .def("normalize",
-             [](FunctionTree<D, double> *out) {
-                 out->normalize();
-                 return out;
-             })
+        .def(
+            "deleteGenerated",
+            [](FunctionTree<D, double> &tree) {
+                TreeLock lock(&tree);
+                tree.deleteGenerated();
+            },
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "memory",
+            [](FunctionTree<D, double> &tree) {
+                PyTreeMemory mem;
+                {
+                    py::gil_scoped_release release;
+                    TreeLock lock(&tree);
+                    mem = tree_memory<D>(tree);
+                    PyTreeCounter::get().update(&tree, mem.allocated());
+                }
+                return py::dict("nodes"_a = mem.nodeBytes,
+                                "coefs"_a = mem.coefBytes,
+                                "gen_nodes"_a = mem.genBytes,
+                                "allocated"_a = mem.allocated(),
+                                "used"_a = mem.usedBytes,
+                                "unused"_a = mem.unused(),
+                                "chunks"_a = mem.nChunks);
+            },
+            R"mydelimiter(
+            Memory held by the tree, in bytes, as a dict.
+
+            nodes and coefs are the allocated node and coefficient chunks,
+            gen_nodes the chunks of the generated nodes, and allocated their
+            sum. used is the part occupied by existing nodes, and unused the
+            remaining capacity. Chunks are kept when nodes are removed, e.g.
+            by crop(), while a deepCopy() only allocates what its nodes need.
+            )mydelimiter")
+        .def(
+            "coefChunks",
+            [](py::object self) {
+                auto &tree = self.cast<FunctionTree<D, double> &>();
+                auto &allocator = tree.getNodeAllocator();
+                int nCoefs = allocator.getNCoefs();
+                py::ssize_t nodesPerChunk = allocator.getCoefChunkSize() / (nCoefs * sizeof(double));
+                py::list chunks;
+                for (int i = 0; i < allocator.getNChunksUsed(); i++) {
+                    chunks.append(py::array_t<double>({nodesPerChunk, static_cast<py::ssize_t>(nCoefs)}, allocator.getCoefChunk(i), self));
+                }
+                return chunks;
+            },
+            R"mydelimiter(
+            Writable NumPy views of the contiguous coefficient chunks of the tree.
+
+            Each chunk is an (nodes, nCoefs) array with one row per node slot
+            of the chunk, in allocation order. Slots of deleted nodes, e.g.
+            after crop(), and slots not yet used may hold stale data. The
+            views share memory with the tree and are only valid until its grid
+            is modified.
+            )mydelimiter")
+        .def(
+            "integrate",
+            [](FunctionTree<D, double> &tree) {
+                TreeLock lock(&tree);
+                return tree.integrate();
+            },
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "normalize",
+            [](FunctionTree<D, double> *out) {
+                TreeLock lock(out);
+                out->normalize();
+                return out;
+            },
+            py::call_guard<py::gil_scoped_release>())
         .def(
             "saveTree",
             [](FunctionTree<D, double> &obj, const std::string &filename) {
                 namespace fs = std::filesystem;
+                TreeLock lock(&obj);
+                ProfileScope prof("FunctionTree.saveTree", &obj);
                 obj.saveTree(filename);
                 return fs::absolute(fs::path(filename + ".tree"));
             },
-            "filename"_a)
-        .def("loadTree", &FunctionTree<D, double>::loadTree, "filename"_a)
+            "filename"_a,
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "loadTree",
+            [](FunctionTree<D, double> &obj, const std::string &filename) {
+                TreeLock lock(&obj);
+                ProfileScope prof("FunctionTree.loadTree");
+                prof.output(&obj);
+                obj.loadTree(filename);
+            },
+            "filename"_a,
+            py::call_guard<py::gil_scoped_release>())
+        .def("toArrays",
+             &impl__toArrays__<D>,
+             R"mydelimiter(
+             Export the tree as flat NumPy arrays.
+
+             Returns a tuple (scales, translations, coefs) of shapes (N,),
+             (N, D) and (N, nCoefs), with one row per node of the tree (excluding
+             generated nodes) in top-down order. The coefficients of each node
+             hold both scaling and wavelet parts.
+             )mydelimiter")
+        .def("fromArrays",
+             &impl__fromArrays__<D>,
+             "scales"_a,
+             "translations"_a,
+             "coefs"_a,
+             R"mydelimiter(
+             Rebuild the tree from flat NumPy arrays, as returned by toArrays().
+
+             Any existing grid is discarded. Only the end nodes of the input are
+             used, branch nodes are recomputed from them, so the rows may come in
+             any order and branch rows may be omitted.
+             )mydelimiter")
+        .def(py::pickle(
+            [](FunctionTree<D, double> &tree) {
+                auto arrays = impl__toArrays__<D>(tree);
+                return py::make_tuple(tree.getMRA(), tree.getName(), arrays[0], arrays[1], arrays[2]);
+            },
+            [](py::tuple state) {
+                if (state.size() != 5) throw std::runtime_error("Invalid FunctionTree state");
+                auto tree = make_tree<D>(state[0].cast<const MultiResolutionAnalysis<D> &>(), state[1].cast<std::string>());
+                using IntArray = py::array_t<int, py::array::c_style | py::array::forcecast>;
+                using DoubleArray = py::array_t<double, py::array::c_style | py::array::forcecast>;
+                impl__fromArrays__<D>(*tree, state[2].cast<IntArray>(), state[3].cast<IntArray>(), state[4].cast<DoubleArray>());
+                return tree;
+            }))
         .def(
             "crop",
             [](FunctionTree<D, double> *out, double prec, bool abs_prec) {
+                TreeLock lock(out);
+                ProfileScope prof("FunctionTree.crop", out);
+                prof.output(out);
                 out->crop(prec, 1.0, abs_prec);
                 return out;
             },
             "prec"_a,
-            "abs_prec"_a = false)
-        .def("deepCopy",
-             [](FunctionTree<D, double> *inp) {
-                 auto out = std::make_unique<FunctionTree<D, double>>(inp->getMRA());
-                 copy_grid(*out, *inp);
-                 copy_func(*out, *inp);
-                 return out;
-             })
-        .def("__call__", [](FunctionTree<D, double> &func, const Coord<D> &r) { return func.evalf_precise(r); })
-        .def("__pos__", &impl__pos__<D>, py::is_operator())
-        .def("__neg__", &impl__neg__<D>, py::is_operator())
-        .def("__add__", &impl__add__<D>, py::is_operator())
-        .def("__iadd__", &impl__add__<D>, py::is_operator())
-        .def("__sub__", &impl__sub__<D>, py::is_operator())
-        .def("__isub__", &impl__sub__<D>, py::is_operator())
-        .def("__mul__", py::overload_cast<FunctionTree<D, double> *, FunctionTree<D, double> *>(&impl__mul__<D>), py::is_operator())
-        .def("__mul__", py::overload_cast<FunctionTree<D, double> *, double>(&impl__mul__<D>), py::is_operator())
-        .def("__imul__", py::overload_cast<FunctionTree<D, double> *, FunctionTree<D, double> *>(&impl__mul__<D>), py::is_operator())
-        .def("__imul__", py::overload_cast<FunctionTree<D, double> *, double>(&impl__mul__<D>), py::is_operator())
-        .def("__rmul__", py::overload_cast<FunctionTree<D, double> *, double>(&impl__mul__<D>), py::is_operator())
-        .def("__truediv__", &impl__truediv__<D>, py::is_operator())
-        .def("__itruediv__", &impl__truediv__<D>, py::is_operator())
-        .def("__pow__", &impl__pow__<D>, py::is_operator())
-        .def("__ipow__", &impl__pow__<D>, py::is_operator());
-
-    py::class_<MWNode<D, double>>(m, "MWNode")
+            "abs_prec"_a = false,
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "deepCopy",
+            [](FunctionTree<D, double> *inp) {
+                TreeLock lock(inp);
+                ProfileScope prof("FunctionTree.deepCopy", inp);
+                auto out = make_tree<D>(inp->getMRA());
+                prof.output(out);
+                copy_grid(*out, *inp);
+                copy_func(*out, *inp);
+                return out;
+            },
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "__call__",
+            [](FunctionTree<D, double> &func, const Coord<D> &r) {
+                TreeLock lock(&func);
+                return func.evalf_precise(r);
+            },
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "evaluate",
+            [](FunctionTree<D, double> &tree, py::array_t<double, py::array::c_style | py::array::forcecast> points, bool fast) {
+                bool valid = (points.ndim() == 2 and points.shape(1) == D) or (D == 1 and points.ndim() == 1);
+                if (not valid) throw py::value_error("Points must be given as an array of shape (N, D)");
+                auto nPts = points.shape(0);
+                py::array_t<double> values(nPts);
+                auto *vals = values.mutable_data();
+                {
+                    py::gil_scoped_release release;
+                    TreeLock lock(&tree);
+                    ProfileScope prof("FunctionTree.evaluate", &tree);
+                    impl__evaluate__<D>(tree, points.data(), vals, nPts, fast);
+                }
+                return values;
+            },
+            "points"_a,
+            "fast"_a = false,
+            R"mydelimiter(
+            Evaluate the function in an (N, D) array of points, returning N values.
+
+            By default the result equals calling the tree on each point. With
+            fast=True only the scaling coefficients of the end nodes are used,
+            which is cheaper but less accurate.
+            )mydelimiter")
+        .def("__pos__", &impl__pos__<D>, py::is_operator(), py::call_guard<py::gil_scoped_release>())
+        .def("__neg__", &impl__neg__<D>, py::is_operator(), py::call_guard<py::gil_scoped_release>())
+        .def("__add__", &impl__add__<D>, py::is_operator(), py::call_guard<py::gil_scoped_release>())
+        .def("__iadd__", &impl__iadd__<D>, py::is_operator(), py::call_guard<py::gil_scoped_release>())
+        .def("__sub__", &impl__sub__<D>, py::is_operator(), py::call_guard<py::gil_scoped_release>())
+        .def("__isub__", &impl__isub__<D>, py::is_operator(), py::call_guard<py::gil_scoped_release>())
+        .def("__mul__",
+             py::overload_cast<FunctionTree<D, double> *, FunctionTree<D, double> *>(&impl__mul__<D>),
+             py::is_operator(),
+             py::call_guard<py::gil_scoped_release>())
+        .def("__mul__",
+             py::overload_cast<FunctionTree<D, double> *, double>(&impl__mul__<D>),
+             py::is_operator(),
+             py::call_guard<py::gil_scoped_release>())
+        .def("__imul__",
+             py::overload_cast<FunctionTree<D, double> *, FunctionTree<D, double> *>(&impl__imul__<D>),
+             py::is_operator(),
+             py::call_guard<py::gil_scoped_release>())
+        .def("__imul__",
+             py::overload_cast<FunctionTree<D, double> *, double>(&impl__imul__<D>),
+             py::is_operator(),
+             py::call_guard<py::gil_scoped_release>())
+        .def("__rmul__",
+             py::overload_cast<FunctionTree<D, double> *, double>(&impl__mul__<D>),
+             py::is_operator(),
+             py::call_guard<py::gil_scoped_release>())
+        .def("__truediv__", &impl__truediv__<D>, py::is_operator(), py::call_guard<py::gil_scoped_release>())
+        .def("__itruediv__", &impl__itruediv__<D>, py::is_operator(), py::call_guard<py::gil_scoped_release>())
+        .def("__pow__", &impl__pow__<D>, py::is_operator(), py::call_guard<py::gil_scoped_release>())
+        .def("__ipow__", &impl__ipow__<D>, py::is_operator(), py::call_guard<py::gil_scoped_release>());
+
+    py::class_<MWNode<D, double>>(m, "MWNode", py::buffer_protocol())
+        .def_buffer([](MWNode<D, double> &node) -> py::buffer_info {
+            if (not node.hasCoefs()) throw py::value_error("Node has no coefficients");
+            return py::buffer_info(node.getCoefs(), static_cast<py::ssize_t>(node.getNCoefs()));
+        })
+        .def(
+            "coefs",
+            [](py::object self) {
+                auto &node = self.cast<MWNode<D, double> &>();
+                if (not node.hasCoefs()) throw py::value_error("Node has no coefficients");
+                return py::array_t<double>(node.getNCoefs(), node.getCoefs(), self);
+            },
+            R"mydelimiter(
+            Writable NumPy view of the MW coefficients of the node.
+
+            The view shares memory with the tree and is only valid until its
+            grid is modified. After changing coefficients, call calcNorms()
+            on the node and mwTransform() and calcSquareNorm() on the tree.
+            )mydelimiter")
+        .def("calcNorms", &MWNode<D, double>::calcNorms)
         .def("depth", &MWNode<D, double>::getDepth)
         .def("scale", &MWNode<D, double>::getScale)
         .def("nCoefs", &MWNode<D, double>::getNCoefs)
@@ -7,7 +7,11 @@
 #include <array>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 
+#include <MRCPP/constants.h>
+#include <MRCPP/core/InterpolatingBasis.h>
+#include <MRCPP/core/LegendreBasis.h>
 #include <MRCPP/trees/BoundingBox.h>
 #include <MRCPP/trees/MultiResolutionAnalysis.h>
 
@@ -41,6 +45,23 @@ template <int D> void world(pybind11::module &m) {
         .def("size", pybind11::overload_cast<int>(&BoundingBox<D>::size, pybind11::const_), "dim"_a)
         .def(py::self == py::self)
         .def(py::self != py::self)
+        .def(py::pickle(
+            [](const BoundingBox<D> &box) {
+                std::array<int, D> nboxes;
+                for (int d = 0; d < D; d++) nboxes[d] = box.size(d);
+                return py::make_tuple(box.getScale(),
+                                      box.getCornerIndex().getTranslation(),
+                                      nboxes,
+                                      box.getScalingFactors(),
+                                      box.isPeriodic());
+            },
+            [](py::tuple state) {
+                if (state.size() != 5) throw std::runtime_error("Invalid BoundingBox state");
+                auto corner = state[1].cast<std::array<int, D>>();
+                auto nboxes = state[2].cast<std::array<int, D>>();
+                auto scaling = state[3].cast<std::array<double, D>>();
+                return BoundingBox<D>(state[0].cast<int>(), corner, nboxes, scaling, state[4].cast<bool>());
+            }))
         .def("__str__", [](const BoundingBox<D> &box) {
             std::ostringstream os;
             os << box;
@@ -57,6 +78,19 @@ template <int D> void world(pybind11::module &m) {
         .def("maxScale", &MultiResolutionAnalysis<D>::getMaxScale)
         .def(py::self == py::self)
         .def(py::self != py::self)
+        .def(py::pickle(
+            [](const MultiResolutionAnalysis<D> &mra) {
+                const auto &basis = mra.getScalingBasis();
+                return py::make_tuple(mra.getWorldBox(), basis.getScalingOrder(), basis.getScalingType(), mra.getMaxDepth());
+            },
+            [](py::tuple state) {
+                if (state.size() != 4) throw std::runtime_error("Invalid MultiResolutionAnalysis state");
+                auto box = state[0].cast<BoundingBox<D>>();
+                auto order = state[1].cast<int>();
+                auto depth = state[3].cast<int>();
+                if (state[2].cast<int>() == Legendre) return MultiResolutionAnalysis<D>(box, LegendreBasis(order), depth);
+                return MultiResolutionAnalysis<D>(box, InterpolatingBasis(order), depth);
+            }))
         .def("__str__", [](const MultiResolutionAnalysis<D> &mra) {
             std::ostringstream os;
             os << "================================================================" << std::endl;